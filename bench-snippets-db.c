@@ -0,0 +1,259 @@
+/* -*- Mode: C; indent-tabs-mode: t; c-basic-offset: 4; tab-width: 4 -*- */
+/*
+    bench-snippets-db.c
+    Copyright (C) Dragos Dena 2010
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, 
+	Boston, MA  02110-1301  USA
+*/
+
+/* Times the SnippetsDB on generated snippet packs and the expansion of a large
+   snippet. Build it with "make bench-snippets-db" and run it without arguments. */
+
+#include <stdio.h>
+#include <string.h>
+#include "snippet.h"
+#include "snippets-group.h"
+#include "snippets-db.h"
+
+#define SNIPPETS_PER_GROUP   100
+#define N_LOOKUPS            1000000
+#define N_EXPANSIONS         100000
+
+static const guint corpus_sizes[] = {1000, 10000, 100000};
+
+static const gchar *languages[] = {"C", "C++", "Python", "Vala"};
+
+static const gchar *license_header =
+	"/* -*- Mode: C; indent-tabs-mode: t; c-basic-offset: 4; tab-width: 4 -*- */\n"
+	"/*\n"
+	"    ${file_name}\n"
+	"    Copyright (C) ${author} ${year}\n"
+	"\n"
+	"    This program is free software; you can redistribute it and/or modify\n"
+	"    it under the terms of the GNU General Public License as published by\n"
+	"    the Free Software Foundation; either version 2 of the License, or\n"
+	"    (at your option) any later version.\n"
+	"\n"
+	"    This program is distributed in the hope that it will be useful,\n"
+	"    but WITHOUT ANY WARRANTY; without even the implied warranty of\n"
+	"    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the\n"
+	"    GNU General Public License for more details.\n"
+	"\n"
+	"    You should have received a copy of the GNU General Public License\n"
+	"    along with this program; if not, write to the Free Software\n"
+	"    Foundation, Inc., 51 Franklin Street, Fifth Floor,\n"
+	"    Boston, MA  02110-1301  USA\n"
+	"*/\n"
+	"\n"
+	"${END_CURSOR_POSITION}\n";
+
+/* Builds a pack like the shared ones: groups of SNIPPETS_PER_GROUP snippets, each
+   for one or two languages, with a variable and a few keywords */
+static GList *
+generate_snippets_groups (guint n_snippets)
+{
+	GList *snippets_groups = NULL, *snippet_languages = NULL, *keywords = NULL,
+	      *variable_names = NULL, *variable_defaults = NULL, *variable_globals = NULL;
+	AnjutaSnippetsGroup *snippets_group = NULL;
+	AnjutaSnippet *snippet = NULL;
+	gchar *group_name = NULL, *trigger = NULL, *name = NULL;
+	guint i = 0;
+
+	variable_names    = g_list_append (NULL, "name");
+	variable_defaults = g_list_append (NULL, "value");
+	variable_globals  = g_list_append (NULL, GINT_TO_POINTER (FALSE));
+	keywords          = g_list_append (NULL, "generated");
+	keywords          = g_list_append (keywords, "benchmark");
+
+	for (i = 0; i < n_snippets; i ++)
+	{
+		if (i % SNIPPETS_PER_GROUP == 0)
+		{
+			group_name = g_strdup_printf ("Group %u", i / SNIPPETS_PER_GROUP);
+			snippets_group = snippets_group_new (group_name);
+			snippets_groups = g_list_prepend (snippets_groups, snippets_group);
+			g_free (group_name);
+		}
+
+		snippet_languages = g_list_append (NULL, (gpointer)languages[i % G_N_ELEMENTS (languages)]);
+		if (i % 2 == 0)
+			snippet_languages = g_list_append (snippet_languages,
+			                                   (gpointer)languages[(i + 1) % G_N_ELEMENTS (languages)]);
+
+		trigger = g_strdup_printf ("trigger%u", i);
+		name    = g_strdup_printf ("Generated snippet %u", i);
+		snippet = snippet_new (trigger, snippet_languages, name,
+		                       "for (${name} = 0; ${name} < n; ${name} ++)\n\t${END_CURSOR_POSITION}\n",
+		                       variable_names, variable_defaults, variable_globals, keywords);
+		snippets_group_add_snippet (snippets_group, snippet);
+
+		g_free (trigger);
+		g_free (name);
+		g_list_free (snippet_languages);
+	}
+
+	g_list_free (variable_names);
+	g_list_free (variable_defaults);
+	g_list_free (variable_globals);
+	g_list_free (keywords);
+
+	return g_list_reverse (snippets_groups);
+}
+
+/* Adds the groups in a batch, like snippets_db_load does */
+static gdouble
+load_snippets_groups (SnippetsDB *snippets_db,
+                      GList *snippets_groups)
+{
+	GTimer *timer = NULL;
+	GList *iter = NULL;
+	gdouble elapsed = 0.0;
+
+	timer = g_timer_new ();
+	snippets_db_begin_batch (snippets_db);
+	for (iter = g_list_first (snippets_groups); iter != NULL; iter = g_list_next (iter))
+		snippets_db_add_snippets_group (snippets_db, ANJUTA_SNIPPETS_GROUP (iter->data), TRUE);
+	snippets_db_end_batch (snippets_db);
+	elapsed = g_timer_elapsed (timer, NULL);
+	g_timer_destroy (timer);
+
+	return elapsed;
+}
+
+/* Looks up the snippets by trigger-key and language, as when the user presses Tab.
+   Every other lookup misses, with a trigger-key that doesn't exist. */
+static gdouble
+lookup_snippets (SnippetsDB *snippets_db,
+                 guint n_snippets)
+{
+	GTimer *timer = NULL;
+	gchar **triggers = NULL;
+	guint i = 0, n_found = 0, index = 0;
+	gdouble elapsed = 0.0;
+
+	triggers = g_new0 (gchar *, 2 * n_snippets + 1);
+	for (i = 0; i < 2 * n_snippets; i ++)
+		triggers[i] = g_strdup_printf (i % 2 == 0 ? "trigger%u" : "missing%u", i / 2);
+
+	timer = g_timer_new ();
+	for (i = 0; i < N_LOOKUPS; i ++)
+	{
+		index = i % (2 * n_snippets);
+		if (snippets_db_get_snippet (snippets_db, triggers[index],
+		                             languages[(index / 2) % G_N_ELEMENTS (languages)]) != NULL)
+			n_found ++;
+	}
+	elapsed = g_timer_elapsed (timer, NULL);
+	g_timer_destroy (timer);
+
+	g_assert (n_found == N_LOOKUPS / 2);
+	g_strfreev (triggers);
+
+	return elapsed;
+}
+
+static void
+bench_corpus (guint n_snippets)
+{
+	SnippetsDB *snippets_db = NULL;
+	GList *snippets_groups = NULL;
+	gdouble elapsed = 0.0;
+
+	snippets_groups = generate_snippets_groups (n_snippets);
+	snippets_db = snippets_db_new ();
+
+	elapsed = load_snippets_groups (snippets_db, snippets_groups);
+	printf ("%6u snippets: load %8.1f ms %6.2f us/snippet\n",
+	        n_snippets, elapsed * 1e3, elapsed * 1e6 / n_snippets);
+
+	elapsed = lookup_snippets (snippets_db, n_snippets);
+	printf ("%6u snippets: %.2f M lookups/s\n", n_snippets, N_LOOKUPS / elapsed / 1e6);
+
+	g_list_foreach (snippets_groups, (GFunc)g_object_unref, NULL);
+	g_list_free (snippets_groups);
+	g_object_unref (snippets_db);
+}
+
+static void
+bench_expansion (const gchar *title,
+                 SnippetsDB *snippets_db,
+                 AnjutaSnippet *snippet)
+{
+	AnjutaSnippetExpansion *expansion = NULL;
+	GTimer *timer = NULL;
+	gsize bytes = 0;
+	guint i = 0;
+	gdouble elapsed = 0.0;
+
+	timer = g_timer_new ();
+	for (i = 0; i < N_EXPANSIONS; i ++)
+	{
+		expansion = snippet_expand (snippet, G_OBJECT (snippets_db), "\t\t");
+		bytes += strlen (expansion->text);
+		snippet_expansion_free (expansion);
+	}
+	elapsed = g_timer_elapsed (timer, NULL);
+	g_timer_destroy (timer);
+
+	printf ("%-28s %8.0f expansions/s %8.1f MB/s\n",
+	        title, N_EXPANSIONS / elapsed, bytes / elapsed / 1e6);
+}
+
+/* Expands a license header, with the local variables only, which is answered
+   from the cache of the snippet, and with a global variable, which is expanded
+   every time */
+static void
+bench_license_header (void)
+{
+	SnippetsDB *snippets_db = NULL;
+	AnjutaSnippet *snippet = NULL;
+	GList *snippet_languages = NULL;
+
+	snippets_db = snippets_db_new ();
+	snippets_db_add_global_variable (snippets_db, "author", "Dragos Dena", FALSE, TRUE);
+	snippet_languages = g_list_append (NULL, "C");
+
+	snippet = snippet_new ("license", snippet_languages, "License header", license_header,
+	                       NULL, NULL, NULL, NULL);
+	snippet_add_variable (snippet, "file_name", "snippets-db.c", FALSE);
+	snippet_add_variable (snippet, "author", "Dragos Dena", FALSE);
+	snippet_add_variable (snippet, "year", "2010", FALSE);
+	bench_expansion ("License header, local vars:", snippets_db, snippet);
+
+	snippet_set_variable_global (snippet, "author", TRUE);
+	bench_expansion ("License header, global var:", snippets_db, snippet);
+
+	g_object_unref (snippet);
+	g_list_free (snippet_languages);
+	g_object_unref (snippets_db);
+}
+
+int
+main (int argc,
+      char *argv[])
+{
+	guint i = 0;
+
+#if !GLIB_CHECK_VERSION (2, 35, 0)
+	g_type_init ();
+#endif
+
+	for (i = 0; i < G_N_ELEMENTS (corpus_sizes); i ++)
+		bench_corpus (corpus_sizes[i]);
+	bench_license_header ();
+
+	return 0;
+}
@@ -0,0 +1,253 @@
+/* -*- Mode: C; indent-tabs-mode: t; c-basic-offset: 4; tab-width: 4 -*- */
+/*
+    bench-snippets-search.c
+    Copyright (C) Dragos Dena 2010
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, 
+	Boston, MA  02110-1301  USA
+*/
+
+/* Times the search kernels on generated snippet keys and both scoring modes of
+   the provider on a generated corpus. Build it with "make bench-snippets-search"
+   and run it without arguments. */
+
+#include <stdio.h>
+#include <string.h>
+#include "snippet.h"
+#include "snippets-search.h"
+
+#define N_KEYS         100000
+#define N_ROUNDS       20
+#define N_SNIPPETS     100000
+#define N_KEYWORDS     4
+#define RANDOM_SEED    42
+
+typedef struct _BenchSnippet
+{
+	gchar *trigger;
+	gchar *name;
+	gchar **keywords;
+	guint64 chars_mask;
+} BenchSnippet;
+
+static const gchar *syllables[] = {
+	"for", "while", "if", "else", "switch", "case", "class", "struct", "int", "char",
+	"print", "list", "map", "get", "set", "init", "free", "new", "loop", "try"
+};
+
+/* Builds a lower-cased key like the ones in a snippets database: a few syllables
+   joined by the separator, more of them for the longer keys */
+static gchar *
+generate_key (GRand *rand,
+              gint n_syllables,
+              gchar separator)
+{
+	GString *key = g_string_new (NULL);
+	gint i = 0;
+
+	for (i = 0; i < n_syllables; i ++)
+	{
+		if (i > 0)
+			g_string_append_c (key, separator);
+		g_string_append (key, syllables[g_rand_int_range (rand, 0, G_N_ELEMENTS (syllables))]);
+	}
+
+	return g_string_free (key, FALSE);
+}
+
+static void
+bench_kernel (const gchar *kernel_name,
+              SnippetsCountOccurrencesFunc count_occurrences,
+              gchar **keys,
+              gsize *keys_lengths,
+              const gchar *needle)
+{
+	GTimer *timer = NULL;
+	gsize needle_len = strlen (needle), bytes = 0;
+	guint count = 0;
+	gint round = 0, i = 0;
+	gdouble elapsed = 0.0;
+
+	timer = g_timer_new ();
+	for (round = 0; round < N_ROUNDS; round ++)
+	{
+		for (i = 0; i < N_KEYS; i ++)
+		{
+			if (keys_lengths[i] < needle_len)
+				continue;
+			count += count_occurrences (keys[i], keys_lengths[i], needle, needle_len);
+			bytes += keys_lengths[i];
+		}
+	}
+	elapsed = g_timer_elapsed (timer, NULL);
+	g_timer_destroy (timer);
+
+	printf ("  %-7s %-10s %8.1f ns/key %9.1f MB/s  (%u matches)\n",
+	        kernel_name, needle,
+	        elapsed * 1e9 / ((gdouble)N_KEYS * N_ROUNDS),
+	        bytes / elapsed / 1e6,
+	        count / N_ROUNDS);
+}
+
+static void
+bench_keys (const gchar *title,
+            GRand *rand,
+            gint min_syllables,
+            gint max_syllables)
+{
+	gchar **keys = g_new0 (gchar *, N_KEYS + 1);
+	gsize *keys_lengths = g_new (gsize, N_KEYS), total_len = 0;
+	const gchar *needles[] = {"f", "get", "init_"};
+	gint i = 0;
+	guint j = 0;
+
+	for (i = 0; i < N_KEYS; i ++)
+	{
+		keys[i] = generate_key (rand, g_rand_int_range (rand, min_syllables, max_syllables + 1), '_');
+		keys_lengths[i] = strlen (keys[i]);
+		total_len += keys_lengths[i];
+	}
+
+	printf ("%s: %d keys, %.1f bytes on average\n", title, N_KEYS, (gdouble)total_len / N_KEYS);
+	for (j = 0; j < G_N_ELEMENTS (needles); j ++)
+	{
+		bench_kernel ("scalar", snippets_search_count_occurrences_scalar, keys, keys_lengths, needles[j]);
+#ifdef SNIPPETS_SEARCH_HAVE_X86_SIMD
+		bench_kernel ("sse2", snippets_search_count_occurrences_sse2, keys, keys_lengths, needles[j]);
+#endif
+	}
+
+	g_strfreev (keys);
+	g_free (keys_lengths);
+}
+
+static guint64
+get_chars_mask (const gchar *string,
+                guint64 chars_mask)
+{
+	for (; *string != '\0'; string ++)
+		chars_mask |= SNIPPET_CHAR_MASK_BIT (*string);
+
+	return chars_mask;
+}
+
+/* Scores the whole corpus for the typed words, as a completion job does when it
+   has no previous candidates to narrow */
+static void
+bench_scoring (const gchar *scoring_name,
+               SnippetsWordRelevanceFunc get_word_relevance,
+               gboolean check_chars_mask,
+               BenchSnippet *snippets,
+               const gchar *typed_text)
+{
+	GTimer *timer = NULL;
+	GList *words_list = NULL;
+	gchar **words = NULL;
+	guint64 words_chars_mask = 0;
+	guint n_relevant = 0;
+	gint round = 0, i = 0;
+	gdouble elapsed = 0.0;
+
+	words = g_strsplit (typed_text, " ", -1);
+	for (i = 0; words[i] != NULL; i ++)
+	{
+		words_list = g_list_append (words_list, words[i]);
+		words_chars_mask = get_chars_mask (words[i], words_chars_mask);
+	}
+
+	timer = g_timer_new ();
+	for (round = 0; round < N_ROUNDS; round ++)
+	{
+		n_relevant = 0;
+		for (i = 0; i < N_SNIPPETS; i ++)
+		{
+			if (check_chars_mask && (words_chars_mask & ~snippets[i].chars_mask))
+				continue;
+			if (snippets_search_get_relevance (snippets[i].trigger, snippets[i].name,
+			                                   snippets[i].keywords, words_list,
+			                                   get_word_relevance) > 0.0)
+				n_relevant ++;
+		}
+	}
+	elapsed = g_timer_elapsed (timer, NULL);
+	g_timer_destroy (timer);
+
+	printf ("  %-9s %-12s %8.2f ms/scan %9.1f ns/snippet  (%u relevant)\n",
+	        scoring_name, typed_text,
+	        elapsed * 1e3 / N_ROUNDS,
+	        elapsed * 1e9 / ((gdouble)N_SNIPPETS * N_ROUNDS),
+	        n_relevant);
+
+	g_list_free (words_list);
+	g_strfreev (words);
+}
+
+static void
+bench_corpus (GRand *rand)
+{
+	BenchSnippet *snippets = g_new0 (BenchSnippet, N_SNIPPETS);
+	const gchar *typed_texts[] = {"f", "for", "fori", "get map", "lp"};
+	guint64 chars_mask = 0;
+	gint i = 0, k = 0;
+	guint j = 0;
+
+	for (i = 0; i < N_SNIPPETS; i ++)
+	{
+		snippets[i].trigger  = generate_key (rand, g_rand_int_range (rand, 1, 3), '_');
+		snippets[i].name     = generate_key (rand, g_rand_int_range (rand, 2, 5), ' ');
+		snippets[i].keywords = g_new0 (gchar *, N_KEYWORDS + 1);
+		chars_mask = get_chars_mask (snippets[i].trigger, 0);
+		chars_mask = get_chars_mask (snippets[i].name, chars_mask);
+		for (k = 0; k < N_KEYWORDS; k ++)
+		{
+			snippets[i].keywords[k] = generate_key (rand, 1, ' ');
+			chars_mask = get_chars_mask (snippets[i].keywords[k], chars_mask);
+		}
+		snippets[i].chars_mask = chars_mask;
+	}
+
+	printf ("Scoring: %d snippets\n", N_SNIPPETS);
+	for (j = 0; j < G_N_ELEMENTS (typed_texts); j ++)
+	{
+		bench_scoring ("relevance", snippets_search_get_word_relevance, FALSE,
+		               snippets, typed_texts[j]);
+		bench_scoring ("fuzzy", snippets_search_get_fuzzy_word_relevance, TRUE,
+		               snippets, typed_texts[j]);
+	}
+
+	for (i = 0; i < N_SNIPPETS; i ++)
+	{
+		g_free (snippets[i].trigger);
+		g_free (snippets[i].name);
+		g_strfreev (snippets[i].keywords);
+	}
+	g_free (snippets);
+}
+
+int
+main (int argc,
+      char *argv[])
+{
+	GRand *rand = g_rand_new_with_seed (RANDOM_SEED);
+
+	bench_keys ("Triggers", rand, 1, 2);
+	bench_keys ("Names and keywords", rand, 2, 6);
+	bench_keys ("Long keys", rand, 10, 20);
+	bench_corpus (rand);
+
+	g_rand_free (rand);
+
+	return 0;
+}
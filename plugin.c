@@ -27,6 +27,7 @@
 #include <libanjuta/interfaces/ianjuta-document-manager.h>
 #include <libanjuta/interfaces/ianjuta-preferences.h>
 #include <libanjuta/interfaces/ianjuta-editor-language.h>
+#include <libanjuta/interfaces/ianjuta-language.h>
 #include <gio/gio.h>
 #include <libanjuta/anjuta-shell.h>
 #include <libanjuta/anjuta-debug.h>
@@ -37,6 +38,9 @@
 #define SNIPPETS_MANAGER_PREFERENCES_ROOT "snippets_preferences_root"
 #define MENU_UI                           PACKAGE_DATA_DIR"/ui/snippets-manager-ui.xml"
 
+#define SNIPPETS_FUZZY_MATCHING_KEY       "snippets.fuzzy.matching"
+#define SNIPPETS_MAX_PROPOSALS_KEY        "snippets.max.proposals"
+
 #define GLOBAL_VAR_NEW_NAME   "new_global_var_name"
 #define GLOBAL_VAR_NEW_VALUE  "new_global_var_value"
 
@@ -174,6 +178,78 @@ on_menu_export_snippets (GtkAction *action,
 	snippets_manager_export_snippets (plugin->snippets_db, p->shell);
 }
 
+static void
+update_current_language (SnippetsManagerPlugin *snippets_manager_plugin)
+{
+	IAnjutaLanguage *ilanguage = NULL;
+	const gchar *language = NULL;
+
+	/* Assertions */
+	g_return_if_fail (ANJUTA_IS_PLUGIN_SNIPPETS_MANAGER (snippets_manager_plugin));
+
+	ilanguage = anjuta_shell_get_interface (ANJUTA_PLUGIN (snippets_manager_plugin)->shell,
+	                                        IAnjutaLanguage,
+	                                        NULL);
+
+	if (IANJUTA_IS_LANGUAGE (ilanguage) &&
+	    IANJUTA_IS_EDITOR_LANGUAGE (snippets_manager_plugin->cur_editor_language))
+	{
+		language = ianjuta_language_get_name_from_editor (ilanguage,
+		                                                  IANJUTA_EDITOR_LANGUAGE (snippets_manager_plugin->cur_editor_language),
+		                                                  NULL);
+	}
+
+	snippets_db_set_current_language (snippets_manager_plugin->snippets_db, language);
+}
+
+static void
+on_editor_language_changed (IAnjutaEditorLanguage *editor_language,
+                            const gchar *language,
+                            gpointer user_data)
+{
+	SnippetsManagerPlugin *snippets_manager_plugin = NULL;
+
+	/* Assertions */
+	g_return_if_fail (ANJUTA_IS_PLUGIN_SNIPPETS_MANAGER (user_data));
+	snippets_manager_plugin = ANJUTA_PLUGIN_SNIPPETS_MANAGER (user_data);
+
+	update_current_language (snippets_manager_plugin);
+	snippets_browser_refilter_snippets_view (snippets_manager_plugin->snippets_browser);
+}
+
+static void
+set_current_editor_language (SnippetsManagerPlugin *snippets_manager_plugin,
+                             GObject *cur_editor)
+{
+	/* Assertions */
+	g_return_if_fail (ANJUTA_IS_PLUGIN_SNIPPETS_MANAGER (snippets_manager_plugin));
+
+	/* Stop watching the old editor. The weak pointer is NULL if it was destroyed. */
+	if (snippets_manager_plugin->cur_editor_language != NULL)
+	{
+		g_signal_handlers_disconnect_by_func (snippets_manager_plugin->cur_editor_language,
+		                                      G_CALLBACK (on_editor_language_changed),
+		                                      snippets_manager_plugin);
+		g_object_remove_weak_pointer (snippets_manager_plugin->cur_editor_language,
+		                              (gpointer *)&snippets_manager_plugin->cur_editor_language);
+		snippets_manager_plugin->cur_editor_language = NULL;
+	}
+
+	if (IANJUTA_IS_EDITOR_LANGUAGE (cur_editor))
+	{
+		snippets_manager_plugin->cur_editor_language = cur_editor;
+		g_object_add_weak_pointer (cur_editor,
+		                           (gpointer *)&snippets_manager_plugin->cur_editor_language);
+		g_signal_connect (cur_editor,
+		                  "language-changed",
+		                  G_CALLBACK (on_editor_language_changed),
+		                  snippets_manager_plugin);
+	}
+
+	/* Resolve the language once, the components read the cached value */
+	update_current_language (snippets_manager_plugin);
+}
+
 static void
 on_added_current_document (AnjutaPlugin *plugin, 
                            const gchar *name,
@@ -196,6 +272,9 @@ on_added_current_document (AnjutaPlugin *plugin,
 		snippets_interaction_set_editor (snippets_manager_plugin->snippets_interaction,
 		                                 NULL);
 
+	/* Cache the language of the new document */
+	set_current_editor_language (snippets_manager_plugin, cur_editor);
+
 	/* Refilter the snippets shown in the browser */
 	snippets_browser_refilter_snippets_view (snippets_manager_plugin->snippets_browser);
 
@@ -222,6 +301,8 @@ on_removed_current_document (AnjutaPlugin *plugin,
 
 	snippets_interaction_set_editor (snippets_manager_plugin->snippets_interaction,
 	                                 NULL);
+
+	set_current_editor_language (snippets_manager_plugin, NULL);
 }
 
 static void
@@ -264,11 +345,47 @@ on_snippets_browser_unmaximize_request (SnippetsBrowser *snippets_browser,
 	snippets_manager_plugin->browser_maximized = FALSE;
 }
 
+static void
+on_fuzzy_matching_changed (AnjutaPreferences *preferences,
+                           const gchar *key,
+                           gboolean value,
+                           gpointer user_data)
+{
+	SnippetsManagerPlugin *snippets_manager_plugin = NULL;
+
+	/* Assertions */
+	g_return_if_fail (ANJUTA_IS_PLUGIN_SNIPPETS_MANAGER (user_data));
+	snippets_manager_plugin = ANJUTA_PLUGIN_SNIPPETS_MANAGER (user_data);
+
+	snippets_provider_set_scoring (snippets_manager_plugin->snippets_provider,
+	                               value ? SNIPPETS_PROVIDER_SCORING_FUZZY :
+	                                       SNIPPETS_PROVIDER_SCORING_RELEVANCE);
+}
+
+static void
+on_max_proposals_changed (AnjutaPreferences *preferences,
+                          const gchar *key,
+                          gint value,
+                          gpointer user_data)
+{
+	SnippetsManagerPlugin *snippets_manager_plugin = NULL;
+
+	/* Assertions */
+	g_return_if_fail (ANJUTA_IS_PLUGIN_SNIPPETS_MANAGER (user_data));
+	snippets_manager_plugin = ANJUTA_PLUGIN_SNIPPETS_MANAGER (user_data);
+
+	snippets_provider_set_max_proposals (snippets_manager_plugin->snippets_provider,
+	                                     MAX (value, 0));
+}
+
 static gboolean
 snippets_manager_activate (AnjutaPlugin * plugin)
 {
 	SnippetsManagerPlugin *snippets_manager_plugin = ANJUTA_PLUGIN_SNIPPETS_MANAGER (plugin);
 	AnjutaUI *anjuta_ui = NULL;
+	AnjutaPreferences *preferences = NULL;
+	gboolean fuzzy_matching = FALSE;
+	gint max_proposals = 0;
 
 	/* Assertions */
 	g_return_val_if_fail (ANJUTA_IS_PLUGIN_SNIPPETS_MANAGER (snippets_manager_plugin),
@@ -281,6 +398,33 @@ snippets_manager_activate (AnjutaPlugin * plugin)
 	/* Link the AnjutaShell to the SnippetsProvider and load if necessary */
 	snippets_manager_plugin->snippets_provider->anjuta_shell = plugin->shell;
 
+	/* Set up the SnippetsProvider from the preferences and follow their changes */
+	preferences = anjuta_shell_get_preferences (plugin->shell, NULL);
+	fuzzy_matching = anjuta_preferences_get_bool_with_default (preferences,
+	                                                          SNIPPETS_FUZZY_MATCHING_KEY,
+	                                                          FALSE);
+	on_fuzzy_matching_changed (preferences, SNIPPETS_FUZZY_MATCHING_KEY, fuzzy_matching,
+	                           snippets_manager_plugin);
+	snippets_manager_plugin->fuzzy_matching_notify_id =
+		anjuta_preferences_notify_add_bool (preferences,
+		                                    SNIPPETS_FUZZY_MATCHING_KEY,
+		                                    on_fuzzy_matching_changed,
+		                                    snippets_manager_plugin,
+		                                    NULL);
+
+	max_proposals = snippets_provider_get_max_proposals (snippets_manager_plugin->snippets_provider);
+	max_proposals = anjuta_preferences_get_int_with_default (preferences,
+	                                                         SNIPPETS_MAX_PROPOSALS_KEY,
+	                                                         max_proposals);
+	on_max_proposals_changed (preferences, SNIPPETS_MAX_PROPOSALS_KEY, max_proposals,
+	                          snippets_manager_plugin);
+	snippets_manager_plugin->max_proposals_notify_id =
+		anjuta_preferences_notify_add_int (preferences,
+		                                   SNIPPETS_MAX_PROPOSALS_KEY,
+		                                   on_max_proposals_changed,
+		                                   snippets_manager_plugin,
+		                                   NULL);
+
 	/* Load the SnippetsBrowser with the snippets in the SnippetsDB */
 	snippets_manager_plugin->snippets_browser->anjuta_shell = plugin->shell;
 	snippets_browser_load (snippets_manager_plugin->snippets_browser,
@@ -332,6 +476,7 @@ snippets_manager_deactivate (AnjutaPlugin *plugin)
 {
 	SnippetsManagerPlugin *snippets_manager_plugin = NULL;
 	AnjutaUI *anjuta_ui = NULL;
+	AnjutaPreferences *preferences = NULL;
 
 	/* Assertions */
 	g_return_val_if_fail (ANJUTA_IS_PLUGIN_SNIPPETS_MANAGER (plugin), FALSE);
@@ -339,9 +484,19 @@ snippets_manager_deactivate (AnjutaPlugin *plugin)
 	
 	DEBUG_PRINT ("%s", "SnippetsManager: Deactivating SnippetsManager plugin …");
 
+	/* Stop following the preferences */
+	preferences = anjuta_shell_get_preferences (plugin->shell, NULL);
+	anjuta_preferences_notify_remove (preferences,
+	                                  snippets_manager_plugin->fuzzy_matching_notify_id);
+	anjuta_preferences_notify_remove (preferences,
+	                                  snippets_manager_plugin->max_proposals_notify_id);
+	snippets_manager_plugin->fuzzy_matching_notify_id = 0;
+	snippets_manager_plugin->max_proposals_notify_id  = 0;
+
 	anjuta_plugin_remove_watch (plugin, 
 	                            snippets_manager_plugin->cur_editor_watch_id, 
 	                            FALSE);
+	set_current_editor_language (snippets_manager_plugin, NULL);
 
 	/* Remove the Menu UI */
 	anjuta_ui = anjuta_shell_get_ui (plugin->shell, NULL);
@@ -409,10 +564,14 @@ snippets_manager_plugin_instance_init (GObject * obj)
 	snippets_manager->show_only_document_language_snippets = FALSE;
 
 	snippets_manager->cur_editor_watch_id = -1;
+	snippets_manager->cur_editor_language = NULL;
 
 	snippets_manager->action_group = NULL;
 	snippets_manager->uiid = -1;
 
+	snippets_manager->fuzzy_matching_notify_id = 0;
+	snippets_manager->max_proposals_notify_id  = 0;
+
 	snippets_manager->snippets_db = snippets_db_new ();
 	snippets_manager->snippets_interaction = snippets_interaction_new ();
 	snippets_manager->snippets_browser = snippets_browser_new ();
@@ -69,10 +69,18 @@ struct _SnippetsManagerPlugin
 
 	gint cur_editor_watch_id;
 
+	/* The current editor, watched for language changes. The language itself is
+	   cached in the SnippetsDB. */
+	GObject *cur_editor_language;
+
 	/* The Menu UI */
 	GtkActionGroup *action_group;
 	gint uiid;
 
+	/* The notifications of the completion preferences */
+	guint fuzzy_matching_notify_id;
+	guint max_proposals_notify_id;
+
 	gboolean browser_maximized;
 
 };
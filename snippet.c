@@ -28,9 +28,8 @@
 #define SNIPPET_VARIABLE_START(text, index)  (text[index] == '$' && text[index + 1] == '{')
 #define SNIPPET_VARIABLE_END(text, index)    (text[index] == '}')
 
-#define STRING_CUR_POSITION(string)          string->len
-
 #define END_CURSOR_VARIABLE_NAME             "END_CURSOR_POSITION"
+#define EXPANSION_CACHE_SIZE                 4
 #define LANGUAGE_SEPARATOR                   '/'
 
 /**
@@ -38,10 +37,6 @@
  * @variable_name: the name of the variable.
  * @default_value: the default value as it will be inserted in the code.
  * @is_global: if the variable is global accross the SnippetDB. Eg: username or email.
- * @cur_valaue_len: If the snippet was computed recently, it represents the length of the current variable
- *                  (default or global variable)
- * @relative_positions: the relative positions from the start of the snippet code each instance of
- *                      this variable has.
  *
  * The snippet variable structure.
  *
@@ -51,12 +46,46 @@ typedef struct _AnjutaSnippetVariable
 	gchar* variable_name;
 	gchar* default_value;
 	gboolean is_global;
-
-	gint cur_value_len;
-	GPtrArray* relative_positions;
 	
 } AnjutaSnippetVariable;
 
+typedef enum
+{
+	SNIPPET_TOKEN_TEXT = 0,
+	SNIPPET_TOKEN_VARIABLE,
+	SNIPPET_TOKEN_END_CURSOR
+} SnippetTokenType;
+
+/**
+ * SnippetToken:
+ * @type: The type of the token.
+ * @start: For a text token, the offset of the text in the snippet content.
+ * @len: For a text token, the length of the text.
+ * @n_new_lines: For a text token, the number of new lines in the text.
+ * @variable: For a variable token, the variable.
+ * @variable_index: For a variable token, the index of the variable in the variables
+ *                  list.
+ *
+ * A piece of the compiled snippet content: a span of the content which is copied
+ * as it is, a variable or the end cursor position.
+ **/
+typedef struct _SnippetToken
+{
+	SnippetTokenType type;
+	gint start;
+	gint len;
+	gint n_new_lines;
+	AnjutaSnippetVariable *variable;
+	gint variable_index;
+} SnippetToken;
+
+/* An expansion of a snippet without global variables, for an indentation */
+typedef struct _CachedExpansion
+{
+	gchar *indent;
+	AnjutaSnippetExpansion *expansion;
+} CachedExpansion;
+
 
 #define ANJUTA_SNIPPET_GET_PRIVATE(obj) (G_TYPE_INSTANCE_GET_PRIVATE ((obj), ANJUTA_TYPE_SNIPPET, AnjutaSnippetPrivate))
 
@@ -71,14 +100,150 @@ struct _AnjutaSnippetPrivate
 	GList* variables;
 	GList* keywords;
 
-	gint cur_value_end_position;
-
-	gboolean default_computed;
+	/* Lower-cased copies of the fields used when searching, kept in sync by the setters */
+	gchar* search_trigger_key;
+	gchar* search_name;
+	gchar** search_keywords;
+	guint64 search_chars_mask;
+	guint* search_lengths;
+	guint n_search_lengths;
+
+	/* The markup shown in the completion proposals, built when first needed */
+	gchar* proposal_markup;
+
+	/* The content preview shown in the completion proposals, built when first
+	   needed and dropped when the content or the variables change */
+	gchar* preview;
+
+	/* The content compiled to SnippetToken's, built when first needed and dropped
+	   when the content or the variables change */
+	GArray* template_tokens;
+	gboolean template_has_globals;
+
+	/* If the content has no global variables, its expansion only depends on the
+	   indentation. The last expansions (CachedExpansion) are kept here, the most
+	   recently used first, and dropped with the compiled content. Like the other
+	   caches, they aren't locked, so they are only used from the main loop. */
+	GQueue* expansion_cache;
+
+	/* The expansion done by the last snippet_get_default_content call, which the
+	   getters of the variable positions read */
+	AnjutaSnippetExpansion* last_expansion;
 };
 
 
 G_DEFINE_TYPE (AnjutaSnippet, snippet, G_TYPE_OBJECT);
 
+static guint64
+get_chars_mask_for_string (const gchar *string)
+{
+	guint64 chars_mask = 0;
+
+	for (; string != NULL && *string != 0; string ++)
+		chars_mask |= SNIPPET_CHAR_MASK_BIT (*string);
+
+	return chars_mask;
+}
+
+/* Called after any of the search fields changes */
+static void
+update_search_chars_mask (AnjutaSnippetPrivate *priv)
+{
+	gint i = 0;
+
+	priv->search_chars_mask  = get_chars_mask_for_string (priv->search_trigger_key);
+	priv->search_chars_mask |= get_chars_mask_for_string (priv->search_name);
+
+	for (i = 0; priv->search_keywords != NULL && priv->search_keywords[i] != NULL; i ++)
+		priv->search_chars_mask |= get_chars_mask_for_string (priv->search_keywords[i]);
+}
+
+/* Called after any of the search fields changes. The lengths are in the order of
+   snippet_get_search_lengths. */
+static void
+update_search_lengths (AnjutaSnippetPrivate *priv)
+{
+	guint i = 0;
+
+	priv->n_search_lengths = 2;
+	if (priv->search_keywords != NULL)
+		priv->n_search_lengths += g_strv_length (priv->search_keywords);
+
+	g_free (priv->search_lengths);
+	priv->search_lengths = g_new (guint, priv->n_search_lengths);
+
+	priv->search_lengths[0] = (priv->search_trigger_key != NULL) ? strlen (priv->search_trigger_key) : 0;
+	priv->search_lengths[1] = (priv->search_name != NULL) ? strlen (priv->search_name) : 0;
+	for (i = 2; i < priv->n_search_lengths; i ++)
+		priv->search_lengths[i] = strlen (priv->search_keywords[i - 2]);
+}
+
+static void
+update_search_trigger_key (AnjutaSnippetPrivate *priv)
+{
+	g_free (priv->search_trigger_key);
+	priv->search_trigger_key = NULL;
+
+	if (priv->trigger_key != NULL)
+		priv->search_trigger_key = g_utf8_strdown (priv->trigger_key, -1);
+
+	update_search_chars_mask (priv);
+	update_search_lengths (priv);
+}
+
+static void
+update_search_name (AnjutaSnippetPrivate *priv)
+{
+	g_free (priv->search_name);
+	priv->search_name = NULL;
+
+	if (priv->snippet_name != NULL)
+		priv->search_name = g_utf8_strdown (priv->snippet_name, -1);
+
+	update_search_chars_mask (priv);
+	update_search_lengths (priv);
+}
+
+static void
+update_search_keywords (AnjutaSnippetPrivate *priv)
+{
+	GList *iter = NULL;
+	guint i = 0;
+
+	g_strfreev (priv->search_keywords);
+	priv->search_keywords = g_new0 (gchar *, g_list_length (priv->keywords) + 1);
+
+	for (iter = g_list_first (priv->keywords); iter != NULL; iter = g_list_next (iter))
+		priv->search_keywords[i ++] = g_utf8_strdown ((const gchar *)iter->data, -1);
+
+	update_search_chars_mask (priv);
+	update_search_lengths (priv);
+}
+
+static void
+free_cached_expansion (CachedExpansion *cached_expansion)
+{
+	g_free (cached_expansion->indent);
+	snippet_expansion_free (cached_expansion->expansion);
+	g_free (cached_expansion);
+}
+
+/* Called after the content or any of the variables changes */
+static void
+invalidate_content_caches (AnjutaSnippetPrivate *priv)
+{
+	g_free (priv->preview);
+	priv->preview = NULL;
+
+	if (priv->template_tokens != NULL)
+		g_array_free (priv->template_tokens, TRUE);
+	priv->template_tokens = NULL;
+	priv->template_has_globals = FALSE;
+
+	while (priv->expansion_cache != NULL && !g_queue_is_empty (priv->expansion_cache))
+		free_cached_expansion (g_queue_pop_head (priv->expansion_cache));
+}
+
 static void
 snippet_dispose (GObject* snippet)
 {
@@ -112,6 +277,30 @@ snippet_dispose (GObject* snippet)
 	}
 	g_list_free (anjuta_snippet->priv->keywords);
 	anjuta_snippet->priv->keywords = NULL;
+
+	/* Delete the search fields */
+	g_free (anjuta_snippet->priv->search_trigger_key);
+	anjuta_snippet->priv->search_trigger_key = NULL;
+	g_free (anjuta_snippet->priv->search_name);
+	anjuta_snippet->priv->search_name = NULL;
+	g_strfreev (anjuta_snippet->priv->search_keywords);
+	anjuta_snippet->priv->search_keywords = NULL;
+	g_free (anjuta_snippet->priv->search_lengths);
+	anjuta_snippet->priv->search_lengths = NULL;
+	anjuta_snippet->priv->n_search_lengths = 0;
+	g_free (anjuta_snippet->priv->proposal_markup);
+	anjuta_snippet->priv->proposal_markup = NULL;
+	g_free (anjuta_snippet->priv->preview);
+	anjuta_snippet->priv->preview = NULL;
+	if (anjuta_snippet->priv->template_tokens != NULL)
+		g_array_free (anjuta_snippet->priv->template_tokens, TRUE);
+	anjuta_snippet->priv->template_tokens = NULL;
+	if (anjuta_snippet->priv->expansion_cache != NULL)
+	{
+		g_queue_foreach (anjuta_snippet->priv->expansion_cache, (GFunc)free_cached_expansion, NULL);
+		g_queue_free (anjuta_snippet->priv->expansion_cache);
+	}
+	anjuta_snippet->priv->expansion_cache = NULL;
 	
 	/* Delete the snippet variables */
 	for (iter = g_list_first (anjuta_snippet->priv->variables); iter != NULL; iter = g_list_next (iter))
@@ -120,11 +309,14 @@ snippet_dispose (GObject* snippet)
 		
 		g_free (cur_snippet_var->variable_name);
 		g_free (cur_snippet_var->default_value);
-		g_ptr_array_unref (cur_snippet_var->relative_positions);
 		
 		g_free (cur_snippet_var);
 	}
 	g_list_free (anjuta_snippet->priv->variables);
+	anjuta_snippet->priv->variables = NULL;
+
+	snippet_expansion_free (anjuta_snippet->priv->last_expansion);
+	anjuta_snippet->priv->last_expansion = NULL;
 
 	G_OBJECT_CLASS (snippet_parent_class)->dispose (snippet);
 }
@@ -153,6 +345,7 @@ snippet_init (AnjutaSnippet* snippet)
 
 	snippet->priv = priv;
 	snippet->parent_snippets_group = NULL;
+	snippet->position = -1;
 
 	/* Initialize the private field */
 	snippet->priv->trigger_key = NULL;
@@ -162,8 +355,19 @@ snippet_init (AnjutaSnippet* snippet)
 	snippet->priv->variables = NULL;
 	snippet->priv->keywords = NULL;
 
-	snippet->priv->cur_value_end_position = -1;
-	snippet->priv->default_computed = FALSE;
+	snippet->priv->search_trigger_key = NULL;
+	snippet->priv->search_name = NULL;
+	snippet->priv->search_keywords = NULL;
+	snippet->priv->search_chars_mask = 0;
+	snippet->priv->search_lengths = NULL;
+	snippet->priv->n_search_lengths = 0;
+	snippet->priv->proposal_markup = NULL;
+	snippet->priv->preview = NULL;
+	snippet->priv->template_tokens = NULL;
+	snippet->priv->template_has_globals = FALSE;
+	snippet->priv->expansion_cache = g_queue_new ();
+
+	snippet->priv->last_expansion = NULL;
 }
 
 /**
@@ -229,6 +433,11 @@ snippet_new (const gchar* trigger_key,
 		temporary_string_holder = g_strdup ((gchar *)iter1->data);
 		snippet->priv->keywords = g_list_append (snippet->priv->keywords, temporary_string_holder);
 	}
+
+	/* Compute the fields used when searching */
+	update_search_trigger_key (snippet->priv);
+	update_search_name (snippet->priv);
+	update_search_keywords (snippet->priv);
 	
 	/* Make a list of variables */
 	snippet->priv->variables = NULL;
@@ -243,9 +452,6 @@ snippet_new (const gchar* trigger_key,
 		cur_snippet_var->default_value = g_strdup ((gchar*)iter2->data);
 		cur_snippet_var->is_global = GPOINTER_TO_INT (iter3->data);
 		
-		cur_snippet_var->cur_value_len = 0;
-		cur_snippet_var->relative_positions = g_ptr_array_new ();
-		
 		snippet->priv->variables = g_list_append (snippet->priv->variables, cur_snippet_var);
 
 		iter1 = g_list_next (iter1);
@@ -324,6 +530,30 @@ snippet_set_trigger_key (AnjutaSnippet *snippet,
 
 	g_free (priv->trigger_key);
 	priv->trigger_key = g_strdup (new_trigger_key);
+	update_search_trigger_key (priv);
+
+	g_free (priv->proposal_markup);
+	priv->proposal_markup = NULL;
+}
+
+/**
+ * snippet_get_search_trigger_key:
+ * @snippet: A #AnjutaSnippet object.
+ *
+ * Gets the lower-cased trigger-key of the snippet, as used when searching.
+ *
+ * Returns: The lower-cased trigger-key or NULL if @snippet is invalid.
+ **/
+const gchar*
+snippet_get_search_trigger_key (AnjutaSnippet *snippet)
+{
+	AnjutaSnippetPrivate *priv = NULL;
+
+	/* Assertions */
+	g_return_val_if_fail (ANJUTA_IS_SNIPPET (snippet), NULL);
+	priv = ANJUTA_SNIPPET_GET_PRIVATE (snippet);
+
+	return priv->search_trigger_key;
 }
 
 /**
@@ -523,7 +753,59 @@ snippet_set_name (AnjutaSnippet *snippet,
 	g_return_if_fail (new_name != NULL);
 	priv = ANJUTA_SNIPPET_GET_PRIVATE (snippet);
 
+	g_free (priv->snippet_name);
 	priv->snippet_name = g_strdup (new_name);
+	update_search_name (priv);
+
+	g_free (priv->proposal_markup);
+	priv->proposal_markup = NULL;
+}
+
+/**
+ * snippet_get_proposal_markup:
+ * @snippet: A #AnjutaSnippet object.
+ *
+ * Gets the markup shown for the snippet in the completion proposals, which is the
+ * name followed by the bold trigger-key. It's cached until the name or the
+ * trigger-key changes.
+ *
+ * Returns: The markup or NULL if @snippet is invalid.
+ **/
+const gchar*
+snippet_get_proposal_markup (AnjutaSnippet *snippet)
+{
+	AnjutaSnippetPrivate *priv = NULL;
+
+	/* Assertions */
+	g_return_val_if_fail (ANJUTA_IS_SNIPPET (snippet), NULL);
+	priv = ANJUTA_SNIPPET_GET_PRIVATE (snippet);
+
+	if (priv->proposal_markup == NULL)
+		priv->proposal_markup = g_strconcat (priv->snippet_name, " (<b>",
+		                                     priv->trigger_key, "</b>)",
+		                                     NULL);
+
+	return priv->proposal_markup;
+}
+
+/**
+ * snippet_get_search_name:
+ * @snippet: A #AnjutaSnippet object.
+ *
+ * Gets the lower-cased name of the snippet, as used when searching.
+ *
+ * Returns: The lower-cased name or NULL if @snippet is invalid.
+ **/
+const gchar*
+snippet_get_search_name (AnjutaSnippet *snippet)
+{
+	AnjutaSnippetPrivate *priv = NULL;
+
+	/* Assertions */
+	g_return_val_if_fail (ANJUTA_IS_SNIPPET (snippet), NULL);
+	priv = ANJUTA_SNIPPET_GET_PRIVATE (snippet);
+
+	return priv->search_name;
 }
 
 /**
@@ -588,7 +870,77 @@ snippet_set_keywords_list (AnjutaSnippet *snippet,
 		cur_keyword = g_strdup ((const gchar *)iter->data);
 		priv->keywords = g_list_append (priv->keywords, cur_keyword);
 	}
-	
+
+	update_search_keywords (priv);
+}
+
+/**
+ * snippet_get_search_keywords:
+ * @snippet: A #AnjutaSnippet object.
+ *
+ * Gets the lower-cased keywords of the snippet, as used when searching. The
+ * returned array is owned by the snippet and shouldn't be free'd.
+ *
+ * Returns: A NULL-terminated array with the lower-cased keywords or NULL if
+ *          @snippet is invalid.
+ **/
+const gchar* const*
+snippet_get_search_keywords (AnjutaSnippet *snippet)
+{
+	AnjutaSnippetPrivate *priv = NULL;
+
+	/* Assertions */
+	g_return_val_if_fail (ANJUTA_IS_SNIPPET (snippet), NULL);
+	priv = ANJUTA_SNIPPET_GET_PRIVATE (snippet);
+
+	return (const gchar* const*)priv->search_keywords;
+}
+
+/**
+ * snippet_get_search_chars_mask:
+ * @snippet: A #AnjutaSnippet object.
+ *
+ * Gets a mask with the SNIPPET_CHAR_MASK_BIT of every character in the lower-cased
+ * trigger-key, name and keywords. A text whose mask isn't included in it can't
+ * match any of them.
+ *
+ * Returns: The characters mask or 0 if @snippet is invalid.
+ **/
+guint64
+snippet_get_search_chars_mask (AnjutaSnippet *snippet)
+{
+	AnjutaSnippetPrivate *priv = NULL;
+
+	/* Assertions */
+	g_return_val_if_fail (ANJUTA_IS_SNIPPET (snippet), 0);
+	priv = ANJUTA_SNIPPET_GET_PRIVATE (snippet);
+
+	return priv->search_chars_mask;
+}
+
+/**
+ * snippet_get_search_lengths:
+ * @snippet: A #AnjutaSnippet object.
+ * @n_lengths: Will hold the number of lengths.
+ *
+ * Gets the lengths in bytes of the lower-cased search fields: the trigger-key, the
+ * name and then each of the keywords, in order.
+ *
+ * Returns: The lengths, owned by @snippet, or NULL if @snippet is invalid.
+ **/
+const guint*
+snippet_get_search_lengths (AnjutaSnippet *snippet,
+                            guint *n_lengths)
+{
+	AnjutaSnippetPrivate *priv = NULL;
+
+	/* Assertions */
+	g_return_val_if_fail (ANJUTA_IS_SNIPPET (snippet), NULL);
+	g_return_val_if_fail (n_lengths != NULL, NULL);
+	priv = ANJUTA_SNIPPET_GET_PRIVATE (snippet);
+
+	*n_lengths = priv->n_search_lengths;
+	return priv->search_lengths;
 }
 
 /**
@@ -741,10 +1093,9 @@ snippet_add_variable (AnjutaSnippet *snippet,
 	added_var->variable_name      = g_strdup (variable_name);
 	added_var->default_value      = g_strdup (default_value);
 	added_var->is_global          = is_global;
-	added_var->cur_value_len      = 0;
-	added_var->relative_positions = g_ptr_array_new ();
 
 	priv->variables = g_list_prepend (priv->variables, added_var);
+	invalidate_content_caches (priv);
 }
 
 void            
@@ -769,11 +1120,11 @@ snippet_remove_variable (AnjutaSnippet *snippet,
 		{
 			g_free (cur_var->variable_name);
 			g_free (cur_var->default_value);
-			g_ptr_array_free (cur_var->relative_positions, TRUE);
 
 			priv->variables = g_list_remove_link (priv->variables, iter);
 
 			g_free (cur_var);
+			invalidate_content_caches (priv);
 			return;
 		}
 	}
@@ -798,6 +1149,7 @@ snippet_set_variable_name (AnjutaSnippet *snippet,
 
 	g_free (var->variable_name);
 	var->variable_name = g_strdup (new_variable_name);
+	invalidate_content_caches (snippet->priv);
 }
 
 const gchar*
@@ -833,6 +1185,7 @@ snippet_set_variable_default_value (AnjutaSnippet *snippet,
 
 	g_free (var->default_value);
 	var->default_value = g_strdup (default_value);
+	invalidate_content_caches (snippet->priv);
 }
 
 gboolean        
@@ -865,7 +1218,8 @@ snippet_set_variable_global (AnjutaSnippet *snippet,
 	var = get_snippet_variable (snippet, variable_name);
 	g_return_if_fail (var != NULL);
 
-	var->is_global = global;	
+	var->is_global = global;
+	invalidate_content_caches (snippet->priv);
 }
 
 /**
@@ -899,158 +1253,452 @@ snippet_set_content (AnjutaSnippet *snippet,
 	
 	g_free (priv->snippet_content);
 	priv->snippet_content = g_strdup (new_content);
+	invalidate_content_caches (priv);
+}
+
+static gint
+count_new_lines (const gchar *text,
+                 gsize len)
+{
+	const gchar *end = text + len;
+	gint n_new_lines = 0;
+
+	while ((text = memchr (text, '\n', end - text)) != NULL)
+	{
+		n_new_lines ++;
+		text ++;
+	}
+
+	return n_new_lines;
 }
 
 static void
-reset_variables (AnjutaSnippet *snippet)
+append_text_token (GArray *tokens,
+                   const gchar *content,
+                   gint start,
+                   gint end)
 {
-	GList *iter = NULL;
-	AnjutaSnippetVariable *cur_var = NULL;
-	
+	SnippetToken token;
+
+	if (start >= end)
+		return;
+
+	token.type           = SNIPPET_TOKEN_TEXT;
+	token.start          = start;
+	token.len            = end - start;
+	token.n_new_lines    = count_new_lines (content + start, end - start);
+	token.variable       = NULL;
+	token.variable_index = -1;
+	g_array_append_val (tokens, token);
+}
+
+/* Compiles the snippet content to SnippetToken's, so it's parsed only once and the
+   variables aren't looked up by name at each expansion */
+static GArray *
+get_template_tokens (AnjutaSnippet *snippet)
+{
+	AnjutaSnippetPrivate *priv = NULL;
+	const gchar *content = NULL;
+	gchar *cur_var_name = NULL;
+	gint content_size = 0, text_start = 0, i = 0, j = 0;
+	SnippetToken token;
+
 	/* Assertions */
-	g_return_if_fail (ANJUTA_IS_SNIPPET (snippet));
-	g_return_if_fail (snippet->priv != NULL);
-	
-	for (iter = g_list_first (snippet->priv->variables); iter != NULL; iter = g_list_next (iter))
+	g_return_val_if_fail (ANJUTA_IS_SNIPPET (snippet), NULL);
+	priv = ANJUTA_SNIPPET_GET_PRIVATE (snippet);
+
+	if (priv->template_tokens != NULL)
+		return priv->template_tokens;
+
+	content      = priv->snippet_content;
+	content_size = strlen (content);
+	priv->template_tokens = g_array_new (FALSE, FALSE, sizeof (SnippetToken));
+
+	for (i = 0; i < content_size; i ++)
 	{
-		cur_var = (AnjutaSnippetVariable *)iter->data;
+		if (!SNIPPET_VARIABLE_START (content, i))
+			continue;
+
+		/* We search for the variable end */
+		for (j = i + 2; j < content_size && !SNIPPET_VARIABLE_END (content, j); j ++);
+		cur_var_name = g_strndup (content + i + 2, j - i - 2);
+
+		token.start          = 0;
+		token.len            = 0;
+		token.n_new_lines    = 0;
+		token.variable       = NULL;
+		token.variable_index = -1;
+
+		/* We first see if it's the END_CURSOR_POSITION variable. Otherwise, if it's
+		   not one of the snippet variables, it's kept in the text. */
+		if (!g_strcmp0 (cur_var_name, END_CURSOR_VARIABLE_NAME))
+			token.type = SNIPPET_TOKEN_END_CURSOR;
+		else
+		if ((token.variable = get_snippet_variable (snippet, cur_var_name)) != NULL)
+		{
+			token.type           = SNIPPET_TOKEN_VARIABLE;
+			token.variable_index = g_list_index (priv->variables, token.variable);
+
+			if (token.variable->is_global)
+				priv->template_has_globals = TRUE;
+		}
+		else
+		{
+			g_free (cur_var_name);
+			continue;
+		}
 
-		cur_var->cur_value_len = 0;
-		if (cur_var->relative_positions->len > 0)
-			g_ptr_array_remove_range (cur_var->relative_positions, 
-				                      0, cur_var->relative_positions->len);
+		append_text_token (priv->template_tokens, content, text_start, i);
+		g_array_append_val (priv->template_tokens, token);
+
+		g_free (cur_var_name);
+		i = j;
+		text_start = j + 1;
 	}
+	append_text_token (priv->template_tokens, content, text_start, content_size);
 
-	snippet->priv->cur_value_end_position = -1;
+	return priv->template_tokens;
+}
+
+/* Copies len bytes of text to dest, adding the indentation after each new line.
+   Returns the position after the copied text. */
+static gchar *
+copy_text_with_indentation (gchar *dest,
+                            const gchar *text,
+                            gsize len,
+                            const gchar *indent,
+                            gsize indent_len)
+{
+	const gchar *end = text + len, *new_line = NULL;
+
+	while ((new_line = memchr (text, '\n', end - text)) != NULL)
+	{
+		memcpy (dest, text, new_line - text + 1);
+		dest += new_line - text + 1;
+		memcpy (dest, indent, indent_len);
+		dest += indent_len;
+
+		text = new_line + 1;
+	}
+	memcpy (dest, text, end - text);
+
+	return dest + (end - text);
 }
 
 static gchar *
 expand_global_and_default_variables (AnjutaSnippet *snippet,
-                                     gchar *snippet_text,
-                                     SnippetsDB *snippets_db)
+                                     const gchar *indent,
+                                     SnippetsDB *snippets_db,
+                                     AnjutaSnippetExpansion *expansion)
 {
-	gint snippet_text_size = 0, i = 0, j = 0;
-	GString *buffer = NULL;
-	GList *iter = NULL;
+	GArray *tokens = NULL;
+	SnippetToken *cur_token = NULL;
+	AnjutaSnippetVariable *cur_var = NULL;
+	AnjutaSnippetExpandedVariable *cur_expanded_var = NULL;
+	const gchar **values = NULL, **global_names = NULL;
+	gchar **global_values = NULL, *buffer = NULL, *dest = NULL;
+	gsize *values_len = NULL, indent_len = 0, buffer_size = 0;
+	gint cur_position = 0, *global_indexes = NULL;
+	gboolean *resolved = NULL;
+	guint i = 0, n_globals = 0, n_variables = 0;
 
 	/* Assertions */
 	g_return_val_if_fail (ANJUTA_IS_SNIPPETS_DB (snippets_db), NULL);
 	g_return_val_if_fail (ANJUTA_IS_SNIPPET (snippet), NULL);
 
-	/* We get the snippet_text_size (for iterating) and init the buffer */
-	snippet_text_size = strlen (snippet_text);
-	buffer = g_string_new ("");
-
-	/* We reset the variable */
-	reset_variables (snippet);
-	
-	/* We expand the variables to the default value or if they are global variables
-	   we query the database for their value. If the database can't answer to our
-	   request, we fill them also with their default values */
-	for (i = 0; i < snippet_text_size; i ++)
+	tokens      = get_template_tokens (snippet);
+	indent_len  = strlen (indent);
+	n_variables = expansion->n_variables;
+
+	/* The values are indexed by variable, so each one is resolved only once, even
+	   if it appears several times. A value can be NULL, so the resolved variables
+	   are marked apart. */
+	values         = g_new0 (const gchar *, n_variables);
+	values_len     = g_new0 (gsize, n_variables);
+	resolved       = g_new0 (gboolean, n_variables);
+	global_names   = g_new0 (const gchar *, n_variables);
+	global_indexes = g_new0 (gint, n_variables);
+
+	/* Get the default values and the global variables which appear in the content */
+	for (i = 0; i < tokens->len; i ++)
 	{
-		/* If it's the start of a variable name, we look up the end, get the name
-		   and evaluate it. */
-		if (SNIPPET_VARIABLE_START (snippet_text, i))
+		cur_token = &g_array_index (tokens, SnippetToken, i);
+		if (cur_token->type != SNIPPET_TOKEN_VARIABLE || resolved[cur_token->variable_index])
+			continue;
+
+		cur_var = cur_token->variable;
+		resolved[cur_token->variable_index] = TRUE;
+		values[cur_token->variable_index]   = cur_var->default_value;
+
+		if (cur_var->is_global)
 		{
-			GString *cur_var_name = NULL;
-			gchar *cur_var_value = NULL;
-			gint cur_var_value_size = 0;
-			AnjutaSnippetVariable *cur_var = NULL;
-			
-			/* We search for the variable end */
-			cur_var_name = g_string_new ("");
-			for (j = i + 2; j < snippet_text_size && !SNIPPET_VARIABLE_END (snippet_text, j); j ++)
-				cur_var_name = g_string_append_c (cur_var_name, snippet_text[j]);
-
-			/* We first see if it's the END_CURSOR_POSITION variable */
-			if (!g_strcmp0 (cur_var_name->str, END_CURSOR_VARIABLE_NAME))
-			{
-				snippet->priv->cur_value_end_position = STRING_CUR_POSITION (buffer);
-				g_string_free (cur_var_name, TRUE);
-
-				i = j;
-				continue;
-			}
-			
-			/* Look up the variable */
-			for (iter = g_list_first (snippet->priv->variables); iter != NULL; iter = g_list_next (iter))
-			{
-				cur_var = (AnjutaSnippetVariable *)iter->data;
-				if (!g_strcmp0 (cur_var->variable_name, cur_var_name->str))
-					break;
-			}
-
-			/* If iter is NULL, then we didn't found the variable name */
-			if (!iter)
-			{
-				//cur_var_value = g_strconcat ("${", cur_var_name->str, "}", NULL);
-				buffer = g_string_append_c (buffer, snippet_text[i]);
-
-				g_string_free (cur_var_name, TRUE);
-				continue;
-			}
-			else
-			{
-				/* If it's a global variable, we query the database */
-				if (cur_var->is_global)
-					cur_var_value = snippets_db_get_global_variable (snippets_db, 
-					                                                 cur_var_name->str);
-
-				/* If we didn't got an answer from the database or if the variable is not
-				   global, we get the default value. */
-				if (cur_var_value == NULL)
-					cur_var_value = g_strdup (cur_var->default_value);
-
-				i = j;
-			}
-
-			/* Update the variable data */
-			cur_var_value_size = strlen (cur_var_value);
-			cur_var->cur_value_len = cur_var_value_size;
-			g_ptr_array_add (cur_var->relative_positions, 
-			                 GINT_TO_POINTER (STRING_CUR_POSITION (buffer)));
-
-			/* Append the variable value to the buffer */
-			buffer = g_string_append (buffer, cur_var_value);
-
-			g_free (cur_var_value);
-			g_string_free (cur_var_name, TRUE);
+			global_names[n_globals]   = cur_var->variable_name;
+			global_indexes[n_globals] = cur_token->variable_index;
+			n_globals ++;
 		}
+	}
+
+	/* We query the database for the values of the global variables, all at once.
+	   If the database can't answer to our request, we keep their default values. */
+	if (n_globals > 0)
+	{
+		global_values = snippets_db_get_global_variables (snippets_db, global_names, n_globals);
+		for (i = 0; global_values != NULL && i < n_globals; i ++)
+			if (global_values[i] != NULL)
+				values[global_indexes[i]] = global_values[i];
+	}
+
+	for (i = 0; i < n_variables; i ++)
+		if (values[i] != NULL)
+			values_len[i] = strlen (values[i]);
+
+	/* Knowing the values, we compute the exact size of the expanded content */
+	for (i = 0; i < tokens->len; i ++)
+	{
+		cur_token = &g_array_index (tokens, SnippetToken, i);
+
+		if (cur_token->type == SNIPPET_TOKEN_TEXT)
+			buffer_size += cur_token->len + cur_token->n_new_lines * indent_len;
 		else
+		if (cur_token->type == SNIPPET_TOKEN_VARIABLE)
+			buffer_size += values_len[cur_token->variable_index];
+	}
+
+	/* Fill the content in a single allocation, copying whole blocks */
+	buffer = g_malloc (buffer_size + 1);
+	dest   = buffer;
+	for (i = 0; i < tokens->len; i ++)
+	{
+		cur_token = &g_array_index (tokens, SnippetToken, i);
+
+		switch (cur_token->type)
 		{
-			buffer = g_string_append_c (buffer, snippet_text[i]);
+			case SNIPPET_TOKEN_TEXT:
+				dest = copy_text_with_indentation (dest,
+				                                   snippet->priv->snippet_content + cur_token->start,
+				                                   cur_token->len,
+				                                   indent, indent_len);
+				break;
+
+			case SNIPPET_TOKEN_END_CURSOR:
+				expansion->end_position = dest - buffer;
+				break;
+
+			case SNIPPET_TOKEN_VARIABLE:
+				/* Save the variable appearance */
+				cur_expanded_var = &expansion->variables[cur_token->variable_index];
+				cur_expanded_var->value_len = values_len[cur_token->variable_index];
+				cur_position = dest - buffer;
+				g_array_append_val (cur_expanded_var->positions, cur_position);
+
+				memcpy (dest, values[cur_token->variable_index], cur_expanded_var->value_len);
+				dest += cur_expanded_var->value_len;
+				break;
 		}
 	}
-	
-	return g_string_free (buffer, FALSE);
+	g_warn_if_fail (dest == buffer + buffer_size);
+	*dest = 0;
+
+	for (i = 0; global_values != NULL && i < n_globals; i ++)
+		g_free (global_values[i]);
+	g_free (global_values);
+	g_free (global_names);
+	g_free (global_indexes);
+	g_free (values);
+	g_free (values_len);
+	g_free (resolved);
+
+	return buffer;
 }
 
 static gchar *
 get_text_with_indentation (const gchar *text,
                            const gchar *indent)
 {
-	gint text_size = 0, i = 0;
-	GString *text_with_indentation = NULL;
+	gchar *text_with_indentation = NULL, *end = NULL;
+	gsize text_len = 0, indent_len = 0;
 	
 	/* Assertions */
 	g_return_val_if_fail (text != NULL, NULL);
 	g_return_val_if_fail (indent != NULL, NULL);
 
-	/* Init the text_with_indentation string */
-	text_with_indentation = g_string_new ("");
+	text_len   = strlen (text);
+	indent_len = strlen (indent);
+
+	text_with_indentation = g_malloc (text_len + count_new_lines (text, text_len) * indent_len + 1);
+	end = copy_text_with_indentation (text_with_indentation, text, text_len, indent, indent_len);
+	*end = 0;
+
+	return text_with_indentation;
+}
+
+static AnjutaSnippetExpansion *
+copy_expansion (const AnjutaSnippetExpansion *expansion)
+{
+	AnjutaSnippetExpansion *copy = NULL;
+	guint i = 0;
+
+	copy = g_new0 (AnjutaSnippetExpansion, 1);
+	copy->text         = g_strdup (expansion->text);
+	copy->end_position = expansion->end_position;
+	copy->n_variables  = expansion->n_variables;
+	copy->variables    = g_new0 (AnjutaSnippetExpandedVariable, expansion->n_variables);
+
+	for (i = 0; i < expansion->n_variables; i ++)
+	{
+		copy->variables[i].variable_name = g_strdup (expansion->variables[i].variable_name);
+		copy->variables[i].value_len     = expansion->variables[i].value_len;
+		copy->variables[i].positions     = g_array_sized_new (FALSE, FALSE, sizeof (gint),
+		                                                      expansion->variables[i].positions->len);
+		g_array_append_vals (copy->variables[i].positions,
+		                     expansion->variables[i].positions->data,
+		                     expansion->variables[i].positions->len);
+	}
+
+	return copy;
+}
+
+/* Looks up the cached expansion for the indentation and marks it as the most
+   recently used one */
+static const AnjutaSnippetExpansion *
+lookup_cached_expansion (AnjutaSnippetPrivate *priv,
+                         const gchar *indent)
+{
+	GList *iter = NULL;
+	CachedExpansion *cached_expansion = NULL;
+
+	for (iter = priv->expansion_cache->head; iter != NULL; iter = g_list_next (iter))
+	{
+		cached_expansion = (CachedExpansion *)iter->data;
+		if (g_strcmp0 (cached_expansion->indent, indent))
+			continue;
+
+		g_queue_unlink (priv->expansion_cache, iter);
+		g_queue_push_head_link (priv->expansion_cache, iter);
+
+		return cached_expansion->expansion;
+	}
+
+	return NULL;
+}
+
+static void
+add_cached_expansion (AnjutaSnippetPrivate *priv,
+                      const gchar *indent,
+                      const AnjutaSnippetExpansion *expansion)
+{
+	CachedExpansion *cached_expansion = NULL;
+
+	cached_expansion = g_new0 (CachedExpansion, 1);
+	cached_expansion->indent    = g_strdup (indent);
+	cached_expansion->expansion = copy_expansion (expansion);
+	g_queue_push_head (priv->expansion_cache, cached_expansion);
+
+	/* Drop the least recently used one */
+	if (g_queue_get_length (priv->expansion_cache) > EXPANSION_CACHE_SIZE)
+		free_cached_expansion (g_queue_pop_tail (priv->expansion_cache));
+}
+
+/**
+ * snippet_expand:
+ * @snippet: A #AnjutaSnippet object.
+ * @snippets_db: A #SnippetsDB object. This is required for filling the global variables.
+ *               This can be NULL if the snippet is independent of a #SnippetsDB or if
+ *               it doesn't have global variables.
+ * @indent: The indentation of the line where the snippet will be inserted.
+ *
+ * Expands the content of the snippet like #snippet_get_default_content, but returns
+ * the positions of the variables and of the end cursor together with the text,
+ * instead of saving them in @snippet. The returned expansion belongs to the caller,
+ * so an editing session isn't disturbed by other expansions of the same snippet.
+ *
+ * The compiled content and the cached expansions of @snippet are updated without
+ * locking, so this should only be called from the main loop.
+ *
+ * Returns: The expansion, to be freed with #snippet_expansion_free, or NULL if
+ *          @snippet is invalid.
+ **/
+AnjutaSnippetExpansion*
+snippet_expand (AnjutaSnippet *snippet,
+                GObject *snippets_db_obj,
+                const gchar *indent)
+{
+	AnjutaSnippetExpansion *expansion = NULL;
+	const AnjutaSnippetExpansion *cached_expansion = NULL;
+	AnjutaSnippetVariable *cur_var = NULL;
+	gboolean expand_variables = FALSE, cacheable = FALSE;
+	GList *iter = NULL;
+	guint i = 0;
+
+	/* Assertions */
+	g_return_val_if_fail (ANJUTA_IS_SNIPPET (snippet), NULL);
+	g_return_val_if_fail (indent != NULL, NULL);
+
+	/* If there are no global variables, the expansion only depends on the indentation,
+	   so we might have it cached */
+	expand_variables = (snippets_db_obj && ANJUTA_IS_SNIPPETS_DB (snippets_db_obj));
+	if (expand_variables)
+	{
+		get_template_tokens (snippet);
+		cacheable = !snippet->priv->template_has_globals;
+	}
+	if (cacheable && (cached_expansion = lookup_cached_expansion (snippet->priv, indent)) != NULL)
+		return copy_expansion (cached_expansion);
 
-	text_size = strlen (text);
-	for (i = 0; i < text_size; i ++)
+	expansion = g_new0 (AnjutaSnippetExpansion, 1);
+	expansion->end_position = -1;
+
+	/* Make an entry for each variable, in the order of the variables list */
+	expansion->n_variables = g_list_length (snippet->priv->variables);
+	expansion->variables   = g_new0 (AnjutaSnippetExpandedVariable, expansion->n_variables);
+	for (iter = g_list_first (snippet->priv->variables); iter != NULL; iter = g_list_next (iter))
 	{
-		text_with_indentation = g_string_append_c (text_with_indentation, text[i]);
+		cur_var = (AnjutaSnippetVariable *)iter->data;
 
-		/* If we go to a new line, we also add the indentation */
-		if (text[i] == '\n')
-			text_with_indentation = g_string_append (text_with_indentation, indent);
+		expansion->variables[i].variable_name = g_strdup (cur_var->variable_name);
+		expansion->variables[i].value_len     = 0;
+		expansion->variables[i].positions     = g_array_new (FALSE, FALSE, sizeof (gint));
+		i ++;
 	}
 
-	return g_string_free (text_with_indentation, FALSE);
+	/* If we should expand the global variables, we expand the compiled content
+	   while indenting it. Otherwise, we just get the text with indentation. */
+	if (expand_variables)
+		expansion->text = expand_global_and_default_variables (snippet,
+		                                                       indent,
+		                                                       ANJUTA_SNIPPETS_DB (snippets_db_obj),
+		                                                       expansion);
+	else
+		expansion->text = get_text_with_indentation (snippet->priv->snippet_content, indent);
+
+	if (cacheable)
+		add_cached_expansion (snippet->priv, indent, expansion);
+
+	return expansion;
+}
+
+/**
+ * snippet_expansion_free:
+ * @expansion: A #AnjutaSnippetExpansion returned by #snippet_expand or NULL.
+ *
+ * Frees the expansion.
+ **/
+void
+snippet_expansion_free (AnjutaSnippetExpansion *expansion)
+{
+	guint i = 0;
+
+	if (expansion == NULL)
+		return;
+
+	for (i = 0; i < expansion->n_variables; i ++)
+	{
+		g_free (expansion->variables[i].variable_name);
+		g_array_free (expansion->variables[i].positions, TRUE);
+	}
+	g_free (expansion->variables);
+	g_free (expansion->text);
+	g_free (expansion);
 }
 
 /**
@@ -1065,6 +1713,9 @@ get_text_with_indentation (const gchar *text,
  * Every '\n' character will be replaced with a string obtained by concatanating
  * "\n" with indent.
  *
+ * The positions of the variables are saved in @snippet, for the getters below. Use
+ * #snippet_expand to get them without changing @snippet.
+ *
  * Returns: The default content of the snippet or NULL if @snippet is invalid.
  **/
 gchar*
@@ -1072,31 +1723,87 @@ snippet_get_default_content (AnjutaSnippet *snippet,
                              GObject *snippets_db_obj,
                              const gchar *indent)
 {
-	gchar* buffer = NULL, *temp = NULL;
+	AnjutaSnippetExpansion *expansion = NULL;
 	
 	/* Assertions */
 	g_return_val_if_fail (ANJUTA_IS_SNIPPET (snippet), NULL);
 
-	/* Get the with indentation */
-	temp = get_text_with_indentation (snippet->priv->snippet_content, indent);
+	expansion = snippet_expand (snippet, snippets_db_obj, indent);
+	g_return_val_if_fail (expansion != NULL, NULL);
 
-	/* If we should expand the global variables */
-	if (snippets_db_obj && ANJUTA_IS_SNIPPETS_DB (snippets_db_obj))
-	{
-		/* Expand the global variables */
-		buffer = expand_global_and_default_variables (snippet,
-		                                              temp,
-		                                              ANJUTA_SNIPPETS_DB (snippets_db_obj));
-		g_free (temp);
-	}
-	else
+	snippet_expansion_free (snippet->priv->last_expansion);
+	snippet->priv->last_expansion = expansion;
+	
+	return g_strdup (expansion->text);
+}
+
+/**
+ * snippet_get_preview:
+ * @snippet: A #AnjutaSnippet object.
+ *
+ * A preview of the snippet content, as shown in the completion proposals. The local
+ * variables are filled with their default values and the global variables are shown
+ * as ${name} placeholders, as computing them might launch a command. Unlike
+ * #snippet_get_default_content, it doesn't change the variable positions of the last
+ * computed default content.
+ *
+ * It's cached until the content or the variables change.
+ *
+ * Returns: The preview, owned by @snippet, or NULL if @snippet is invalid.
+ **/
+const gchar*
+snippet_get_preview (AnjutaSnippet *snippet)
+{
+	AnjutaSnippetPrivate *priv = NULL;
+	GArray *tokens = NULL;
+	SnippetToken *cur_token = NULL;
+	GString *buffer = NULL;
+	guint i = 0;
+
+	/* Assertions */
+	g_return_val_if_fail (ANJUTA_IS_SNIPPET (snippet), NULL);
+	priv = ANJUTA_SNIPPET_GET_PRIVATE (snippet);
+
+	if (priv->preview != NULL)
+		return priv->preview;
+
+	/* The compiled content is shared with the expansion, so the preview shows the
+	   variables the same way they are expanded */
+	tokens = get_template_tokens (snippet);
+	buffer = g_string_sized_new (strlen (priv->snippet_content));
+
+	for (i = 0; i < tokens->len; i ++)
 	{
-		buffer = temp;
+		cur_token = &g_array_index (tokens, SnippetToken, i);
+
+		switch (cur_token->type)
+		{
+			case SNIPPET_TOKEN_TEXT:
+				buffer = g_string_append_len (buffer,
+				                              priv->snippet_content + cur_token->start,
+				                              cur_token->len);
+				break;
+
+			case SNIPPET_TOKEN_END_CURSOR:
+				break;
+
+			case SNIPPET_TOKEN_VARIABLE:
+				if (cur_token->variable->is_global)
+				{
+					buffer = g_string_append (buffer, "${");
+					buffer = g_string_append (buffer, cur_token->variable->variable_name);
+					buffer = g_string_append_c (buffer, '}');
+				}
+				else
+				if (cur_token->variable->default_value != NULL)
+					buffer = g_string_append (buffer, cur_token->variable->default_value);
+				break;
+		}
 	}
 
-	snippet->priv->default_computed = TRUE;
-	
-	return buffer;
+	priv->preview = g_string_free (buffer, FALSE);
+
+	return priv->preview;
 }
 
 /**
@@ -1121,21 +1828,26 @@ snippet_get_default_content (AnjutaSnippet *snippet,
 GList*	
 snippet_get_variable_relative_positions	(AnjutaSnippet* snippet)
 {
-	GList *relative_positions_list = NULL, *iter = NULL;
-	AnjutaSnippetVariable *cur_variable = NULL;
+	GList *relative_positions_list = NULL;
+	GPtrArray *cur_positions = NULL;
+	AnjutaSnippetExpandedVariable *cur_variable = NULL;
+	guint i = 0, j = 0;
 	
 	/* Assertions */
 	g_return_val_if_fail (ANJUTA_IS_SNIPPET (snippet), NULL);
 	g_return_val_if_fail (snippet->priv != NULL, NULL);
-	g_return_val_if_fail (snippet->priv->default_computed, NULL);
+	g_return_val_if_fail (snippet->priv->last_expansion != NULL, NULL);
 
-	for (iter = g_list_first (snippet->priv->variables); iter != NULL; iter = g_list_next (iter))
+	for (i = 0; i < snippet->priv->last_expansion->n_variables; i ++)
 	{
-		cur_variable = (AnjutaSnippetVariable *)iter->data;
+		cur_variable  = &snippet->priv->last_expansion->variables[i];
+		cur_positions = g_ptr_array_sized_new (cur_variable->positions->len);
+
+		for (j = 0; j < cur_variable->positions->len; j ++)
+			g_ptr_array_add (cur_positions,
+			                 GINT_TO_POINTER (g_array_index (cur_variable->positions, gint, j)));
 
-		relative_positions_list = g_list_append (relative_positions_list,
-		                                         cur_variable->relative_positions);
-		g_ptr_array_ref (cur_variable->relative_positions);
+		relative_positions_list = g_list_append (relative_positions_list, cur_positions);
 	}
 	
 	return relative_positions_list;
@@ -1155,21 +1867,19 @@ snippet_get_variable_relative_positions	(AnjutaSnippet* snippet)
 GList*
 snippet_get_variable_cur_values_len (AnjutaSnippet *snippet)
 {
-	GList *cur_values_len_list = NULL, *iter = NULL;
-	AnjutaSnippetVariable *cur_variable = NULL;
+	GList *cur_values_len_list = NULL;
+	guint i = 0;
 	
 	/* Assertions */
 	g_return_val_if_fail (ANJUTA_IS_SNIPPET (snippet), NULL);
 	g_return_val_if_fail (snippet->priv != NULL, NULL);
 
-	for (iter = g_list_first (snippet->priv->variables); iter != NULL; iter = g_list_next (iter))
-	{
-		cur_variable = (AnjutaSnippetVariable *)iter->data;
+	if (snippet->priv->last_expansion == NULL)
+		return NULL;
 
+	for (i = 0; i < snippet->priv->last_expansion->n_variables; i ++)
 		cur_values_len_list = g_list_append (cur_values_len_list,
-		                                     GINT_TO_POINTER (cur_variable->cur_value_len));
-	
-	}
+		                                     GINT_TO_POINTER (snippet->priv->last_expansion->variables[i].value_len));
 
 	return cur_values_len_list;	
 }
@@ -1183,7 +1893,10 @@ snippet_get_cur_value_end_position (AnjutaSnippet *snippet)
 	g_return_val_if_fail (ANJUTA_IS_SNIPPET (snippet), -1);
 	priv = ANJUTA_SNIPPET_GET_PRIVATE (snippet);
 
-	return priv->cur_value_end_position;
+	if (priv->last_expansion == NULL)
+		return -1;
+
+	return priv->last_expansion->end_position;
 }
 
 /**
@@ -1224,3 +1937,86 @@ snippet_is_equal (AnjutaSnippet *snippet,
 
 	return FALSE;
 }
+
+/**
+ * snippet_key_init:
+ * @snippet_key: The #SnippetKey to be filled.
+ * @trigger_key: The trigger-key.
+ * @language: The language.
+ * @intern: If FALSE, no new quarks are created.
+ *
+ * Fills @snippet_key with the quarks of @trigger_key and @language.
+ *
+ * Returns: FALSE if @intern is FALSE and the trigger-key or the language don't have a
+ *          quark already, meaning no snippet can have this key.
+ */
+gboolean
+snippet_key_init (SnippetKey *snippet_key,
+                  const gchar *trigger_key,
+                  const gchar *language,
+                  gboolean intern)
+{
+	/* Assertions */
+	g_return_val_if_fail (snippet_key != NULL, FALSE);
+	g_return_val_if_fail (trigger_key != NULL, FALSE);
+
+	if (intern)
+	{
+		snippet_key->trigger  = g_quark_from_string (trigger_key);
+		snippet_key->language = g_quark_from_string (language);
+		return TRUE;
+	}
+
+	snippet_key->trigger  = g_quark_try_string (trigger_key);
+	snippet_key->language = g_quark_try_string (language);
+
+	return (snippet_key->trigger != 0 && (snippet_key->language != 0 || language == NULL));
+}
+
+/**
+ * snippet_key_hash:
+ * @key: A #SnippetKey.
+ *
+ * A #GHashFunc for #SnippetKey keys.
+ *
+ * Returns: The hash value of @key.
+ */
+guint
+snippet_key_hash (gconstpointer key)
+{
+	const SnippetKey *snippet_key = (const SnippetKey *)key;
+
+	return (snippet_key->trigger * 31) ^ snippet_key->language;
+}
+
+/**
+ * snippet_key_equal:
+ * @a: A #SnippetKey.
+ * @b: A #SnippetKey.
+ *
+ * A #GEqualFunc for #SnippetKey keys.
+ *
+ * Returns: TRUE if the keys have the same trigger-key and language.
+ */
+gboolean
+snippet_key_equal (gconstpointer a,
+                   gconstpointer b)
+{
+	const SnippetKey *snippet_key1 = (const SnippetKey *)a;
+	const SnippetKey *snippet_key2 = (const SnippetKey *)b;
+
+	return (snippet_key1->trigger == snippet_key2->trigger &&
+	        snippet_key1->language == snippet_key2->language);
+}
+
+/**
+ * snippet_key_free:
+ * @snippet_key: A #SnippetKey allocated with g_slice_dup.
+ *
+ * A #GDestroyNotify for the #SnippetKey keys of a #GHashTable.
+ */
+void
+snippet_key_free (gpointer snippet_key)
+{
+	g_slice_free (SnippetKey, snippet_key);
+}
@@ -38,12 +38,20 @@ typedef struct _AnjutaSnippetClass AnjutaSnippetClass;
 #define ANJUTA_IS_SNIPPET(obj)         (G_TYPE_CHECK_INSTANCE_TYPE ((obj), ANJUTA_TYPE_SNIPPET))
 #define ANJUTA_IS_SNIPPET_CLASS(klass) (G_TYPE_CHECK_CLASS_TYPE ((klass), ANJUTA_TYPE_SNIPPET))
 
+/* The bit of a character in the mask returned by snippet_get_search_chars_mask */
+#define SNIPPET_CHAR_MASK_BIT(c)       (G_GUINT64_CONSTANT (1) << ((guchar)(c) & 63))
+
 struct _AnjutaSnippet
 {
 	GObject parent_instance;
 
 	/* A pointer to an AnjutaSnippetsGroup object. */
 	GObject *parent_snippets_group;
+
+	/* The index of the snippet in the parent snippets group or -1 if it isn't stored
+	   in it. This is maintained lazily by the AnjutaSnippetsGroup, so it should be
+	   read with snippets_group_get_snippet_position. */
+	gint position;
 	
 	/*< private >*/
 	AnjutaSnippetPrivate *priv;
@@ -55,6 +63,56 @@ struct _AnjutaSnippetClass
 
 };
 
+/**
+ * AnjutaSnippetExpandedVariable:
+ * @variable_name: The name of the variable.
+ * @value_len: The length of the value the variable was expanded to.
+ * @positions: The offsets (#gint) of each appearance of the variable in the text.
+ *
+ * The expanded appearances of a snippet variable.
+ */
+typedef struct _AnjutaSnippetExpandedVariable
+{
+	gchar *variable_name;
+	gint value_len;
+	GArray *positions;
+} AnjutaSnippetExpandedVariable;
+
+/**
+ * AnjutaSnippetExpansion:
+ * @text: The expanded content of the snippet.
+ * @variables: The variables of the snippet, in the order of
+ *             #snippet_get_variable_names_list.
+ * @n_variables: The number of variables.
+ * @end_position: The offset of the end cursor position in @text or -1 if the
+ *                snippet doesn't set it.
+ *
+ * A self-contained result of #snippet_expand, freed with #snippet_expansion_free.
+ */
+typedef struct _AnjutaSnippetExpansion
+{
+	gchar *text;
+	AnjutaSnippetExpandedVariable *variables;
+	guint n_variables;
+	gint end_position;
+} AnjutaSnippetExpansion;
+
+/**
+ * SnippetKey:
+ * @trigger: The #GQuark of the trigger-key.
+ * @language: The #GQuark of the language.
+ *
+ * The key of a snippet in the trigger-key and language indexes of the database and of
+ * the groups. A lookup only needs the existing quarks of the strings, so it doesn't
+ * allocate any memory: if the trigger-key or the language were never interned, no
+ * snippet can match them.
+ */
+typedef struct _SnippetKey
+{
+	GQuark trigger;
+	GQuark language;
+} SnippetKey;
+
 GType           snippet_get_type                        (void) G_GNUC_CONST;
 AnjutaSnippet*  snippet_new                             (const gchar *trigger_key,
                                                          GList *snippet_language,
@@ -68,6 +126,7 @@ AnjutaSnippet*  snippet_copy                            (AnjutaSnippet *snippet)
 const gchar*    snippet_get_trigger_key                 (AnjutaSnippet *snippet);
 void            snippet_set_trigger_key                 (AnjutaSnippet *snippet,
                                                          const gchar *new_trigger_key);
+const gchar*    snippet_get_search_trigger_key          (AnjutaSnippet *snippet);
 const GList*    snippet_get_languages                   (AnjutaSnippet *snippet);
 gchar*          snippet_get_languages_string            (AnjutaSnippet *snippet);
 const gchar*    snippet_get_any_language                (AnjutaSnippet *snippet);
@@ -80,9 +139,15 @@ void            snippet_remove_language                 (AnjutaSnippet *snippet,
 const gchar*    snippet_get_name                        (AnjutaSnippet *snippet);
 void            snippet_set_name                        (AnjutaSnippet *snippet,
                                                          const gchar *new_name);
+const gchar*    snippet_get_search_name                 (AnjutaSnippet *snippet);
+const gchar*    snippet_get_proposal_markup             (AnjutaSnippet *snippet);
 GList*          snippet_get_keywords_list               (AnjutaSnippet *snippet);
 void            snippet_set_keywords_list               (AnjutaSnippet *snippet,
                                                          const GList *keywords_list);
+const gchar* const* snippet_get_search_keywords         (AnjutaSnippet *snippet);
+guint64         snippet_get_search_chars_mask           (AnjutaSnippet *snippet);
+const guint*    snippet_get_search_lengths              (AnjutaSnippet *snippet,
+                                                         guint *n_lengths);
 GList*          snippet_get_variable_names_list         (AnjutaSnippet *snippet);
 GList*          snippet_get_variable_defaults_list      (AnjutaSnippet *snippet);
 GList*          snippet_get_variable_globals_list       (AnjutaSnippet *snippet);
@@ -110,15 +175,29 @@ void            snippet_set_variable_global             (AnjutaSnippet *snippet,
 const gchar*    snippet_get_content                     (AnjutaSnippet *snippet);
 void            snippet_set_content                     (AnjutaSnippet *snippet,
                                                          const gchar *new_content);
+AnjutaSnippetExpansion* snippet_expand                  (AnjutaSnippet *snippet,
+                                                         GObject *snippets_db_obj,
+                                                         const gchar *indent);
+void            snippet_expansion_free                  (AnjutaSnippetExpansion *expansion);
 gchar*          snippet_get_default_content             (AnjutaSnippet *snippet,
                                                          GObject *snippets_db_obj,
                                                          const gchar *indent);
+const gchar*    snippet_get_preview                     (AnjutaSnippet *snippet);
 GList*          snippet_get_variable_relative_positions (AnjutaSnippet *snippet);
 GList*          snippet_get_variable_cur_values_len     (AnjutaSnippet *snippet);
 gint            snippet_get_cur_value_end_position      (AnjutaSnippet *snippet);
 gboolean        snippet_is_equal                        (AnjutaSnippet *snippet,
                                                          AnjutaSnippet *snippet2);
 
+gboolean        snippet_key_init                        (SnippetKey *snippet_key,
+                                                         const gchar *trigger_key,
+                                                         const gchar *language,
+                                                         gboolean intern);
+guint           snippet_key_hash                        (gconstpointer key);
+gboolean        snippet_key_equal                       (gconstpointer a,
+                                                         gconstpointer b);
+void            snippet_key_free                        (gpointer snippet_key);
+
 G_END_DECLS
 
 #endif /* __ANJUTA_SNIPPET_H__ */
@@ -400,9 +400,6 @@ snippets_db_language_filter_func (GtkTreeModel *tree_model,
                                   gpointer user_data)
 {
 	SnippetsBrowser *snippets_browser = NULL;
-	IAnjutaDocumentManager *docman = NULL;
-	IAnjutaDocument *doc = NULL;
-	IAnjutaLanguage *ilanguage = NULL;
 	const gchar *language = NULL;
 	GObject *cur_object = NULL;
 	SnippetsBrowserPrivate *priv = NULL;
@@ -439,44 +436,20 @@ snippets_db_language_filter_func (GtkTreeModel *tree_model,
 		g_return_val_if_reached (FALSE);
 	}
 	
-	/* Get the current document manager. If it doesn't exist we show all snippets */
-	docman = anjuta_shell_get_interface (snippets_browser->anjuta_shell, 
-	                                     IAnjutaDocumentManager, 
-	                                     NULL);
-	if (!IANJUTA_IS_DOCUMENT_MANAGER (docman))
-	{
-		g_object_unref (cur_object);
-		return TRUE;
-	}
-
-	ilanguage = anjuta_shell_get_interface (snippets_browser->anjuta_shell,
-	                                        IAnjutaLanguage,
-	                                        NULL);
-	if (!IANJUTA_IS_LANGUAGE (ilanguage))
-	{
-		g_object_unref (cur_object);
-		return TRUE;
-	}
-	
-	/* Get the current doc and if it isn't an editor show all snippets */
-	doc = ianjuta_document_manager_get_current_document (docman, NULL);
-	if (!IANJUTA_IS_EDITOR (doc))
-	{
-		g_object_unref (cur_object);
-		return TRUE;
-	}
-
-	/* Get the language */
-	language = ianjuta_language_get_name_from_editor (ilanguage,
-	                                                  IANJUTA_EDITOR_LANGUAGE (doc),
-	                                                  NULL);
+	/* Get the cached language of the current document. If there isn't a current
+	   editor we show all snippets */
+	language = snippets_db_get_current_language (ANJUTA_SNIPPETS_DB (tree_model));
 	if (language == NULL)
 	{
 		g_object_unref (cur_object);
 		return TRUE;
 	}
 
-	has_language = snippet_has_language (ANJUTA_SNIPPET (cur_object), language);
+	/* The snippet supports the language if it's the one stored for its trigger-key
+	   and the language, which is a single lookup in the snippet-keys map */
+	has_language = (snippets_db_get_snippet (ANJUTA_SNIPPETS_DB (tree_model),
+	                                         snippet_get_trigger_key (ANJUTA_SNIPPET (cur_object)),
+	                                         language) == ANJUTA_SNIPPET (cur_object));
 
 	g_object_unref (cur_object);
 	return has_language;
@@ -989,17 +962,17 @@ on_snippets_view_query_tooltip (GtkWidget *snippets_view,
 
 	if (ANJUTA_IS_SNIPPET (cur_object))
 	{
-		gchar *default_content = NULL, *default_content_preview = NULL, *tooltip_text = NULL;
+		const gchar *preview = NULL;
+		gchar *default_content_preview = NULL, *tooltip_text = NULL;
 
-		default_content = snippet_get_default_content (ANJUTA_SNIPPET (cur_object),
-		                                               G_OBJECT (priv->snippets_db),
-		                                               "");
+		/* The cached preview doesn't launch the commands of the global variables
+		   each time the tooltip is shown */
+		preview = snippet_get_preview (ANJUTA_SNIPPET (cur_object));
 
-		default_content_preview = g_strndup (default_content, TOOLTIP_SIZE);
+		default_content_preview = g_strndup (preview, TOOLTIP_SIZE);
 		tooltip_text = g_strconcat (default_content_preview, " …", NULL);
 		gtk_tooltip_set_text (tooltip, tooltip_text);
 		
-		g_free (default_content);
 		g_free (default_content_preview);
 		g_free (tooltip_text);
 		g_object_unref (cur_object);
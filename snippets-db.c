@@ -25,11 +25,9 @@
 #include <libanjuta/anjuta-debug.h>
 #include <libanjuta/interfaces/ianjuta-document-manager.h>
 #include <libanjuta/interfaces/ianjuta-document.h>
-#include <libanjuta/interfaces/ianjuta-editor.h>
-#include <libanjuta/interfaces/ianjuta-editor-language.h>
-#include <libanjuta/interfaces/ianjuta-language.h>
 #include <glib.h>
 #include <glib/gstdio.h>
+#include <string.h>
 #include <gtk/gtk.h>
 
 #define DEFAULT_SNIPPETS_FILE               "snippets.anjuta-snippets"
@@ -38,12 +36,20 @@
 
 #define SNIPPETS_DB_MODEL_DEPTH             2
 
+#define TRIGRAM_LENGTH                      3
+#define TRIGRAM_KEY(str)                    GUINT_TO_POINTER (((guint)(guchar)(str)[0] << 16) | \
+                                                              ((guint)(guchar)(str)[1] << 8) | \
+                                                              (guint)(guchar)(str)[2])
+
 /* Internal global variables */
 #define GLOBAL_VAR_FILE_NAME       "filename"
 #define GLOBAL_VAR_USER_NAME       "username"
 #define GLOBAL_VAR_USER_FULL_NAME  "userfullname"
 #define GLOBAL_VAR_HOST_NAME       "hostname"
 
+/* The most commands of global variables launched at the same time */
+#define GLOBAL_VAR_COMMANDS_MAX_THREADS  8
+
 static gchar *default_files[] = {
 	DEFAULT_SNIPPETS_FILE,
 	DEFAULT_GLOBAL_VARS_FILE
@@ -54,27 +60,88 @@ static gchar *default_files[] = {
 
 /**
  * SnippetsDBPrivate:
- * @snippets_groups: A #GList where the #AnjutaSnippetsGroup objects are loaded.
- * @snippet_keys_map: A #GHashTable with strings representing the snippet-key as keys and pointers
- *                    to #AnjutaSnippet objects as values.
+ * @snippets_groups: A #GPtrArray where the #AnjutaSnippetsGroup objects are loaded, sorted
+ *                   by name. Each group has the index in this array cached in it's
+ *                   position field.
+ * @stale_groups_positions_start: The index in @snippets_groups from which the cached
+ *                                positions are out of date, or -1 if they are all up
+ *                                to date. They are recomputed when one of them is read.
+ * @snippet_keys_map: A #GHashTable with #SnippetKey structures as keys and pointers
+ *                    to #AnjutaSnippet objects as values. It's also the index used for
+ *                    answering #snippets_db_has_snippet.
  *                    Important: One should not try to delete anything. The #GHashTable was 
  *                    constructed with destroy functions passed to the #GHashTable that will 
  *                    free the memory.
+ * @snippets_groups_map: A #GHashTable with the group names as keys and pointers to the
+ *                       #AnjutaSnippetsGroup objects in @snippets_groups as values. It's
+ *                       the index used for looking up a group by it's name.
  * @global_variables: A #GtkListStore where the static and command-based global variables are stored.
  *                    See snippets-db.h for details about columns.
  *                    Important: Only static and command-based global variables are stored here!
  *                    The internal global variables are computed when #snippets_db_get_global_variable
  *                    is called.
+ * @global_variables_map: A #GHashTable with the global variable names as keys and #GtkTreeIter's
+ *                        pointing to their rows in @global_variables as values. As the
+ *                        #GtkListStore iters persist, it's the index used for looking up a
+ *                        global variable by it's name.
+ * @language_snippets_map: A #GHashTable with language quarks as keys and #GPtrArray's with
+ *                         the #AnjutaSnippet objects supporting that language as values,
+ *                         sorted by trigger-key. It's the index used for listing the
+ *                         snippets of a language by trigger-key prefix.
+ * @language_snippets_unsorted: TRUE if snippets were appended to the arrays in
+ *                              @language_snippets_map (for example, in a batch) and
+ *                              they should be sorted before the next query.
+ * @trigram_snippets_map: A #GHashTable with the byte trigrams (see TRIGRAM_KEY) as keys and
+ *                        #GPtrArray's with the #AnjutaSnippet objects having that trigram
+ *                        in their lower-cased trigger-key, name or keywords as values,
+ *                        sorted by address. It's the inverted index used for finding the
+ *                        snippets containing some search words.
+ * @trigram_snippets_unsorted: Like @language_snippets_unsorted, for @trigram_snippets_map.
+ * @current_language: The interned name of the language of the current document, or NULL if
+ *                    the current document isn't an editor. It's set by the plugin when
+ *                    the current document changes.
+ * @generation: Incremented every time the snippets or the groups change.
+ * @snapshot: The #SnippetsDBSnapshot of the current generation or NULL if it wasn't
+ *            requested yet.
+ * @commands_pool: A #GThreadPool launching the commands of the global variables for
+ *                 #snippets_db_get_global_variables. It's created the first time more
+ *                 than one command should be launched.
+ * @batch_depth: The number of #snippets_db_begin_batch calls not yet matched by a
+ *               #snippets_db_end_batch call.
+ * @n_visible_snippets_groups: While a batch is active, the number of top-level rows the
+ *                             #GtkTreeModel reports. It drops to 0 when the batch starts
+ *                             and the rows are inserted back when it ends.
  *
  * The private field for the SnippetsDB object.
  */
 struct _SnippetsDBPrivate
 {	
-	GList* snippets_groups;
+	GPtrArray* snippets_groups;
+	gint stale_groups_positions_start;
 
 	GHashTable* snippet_keys_map;
+
+	GHashTable* snippets_groups_map;
 	
 	GtkListStore* global_variables;
+
+	GHashTable* global_variables_map;
+
+	GHashTable* language_snippets_map;
+	gboolean language_snippets_unsorted;
+
+	GHashTable* trigram_snippets_map;
+	gboolean trigram_snippets_unsorted;
+
+	const gchar *current_language;
+
+	guint generation;
+	SnippetsDBSnapshot *snapshot;
+
+	GThreadPool *commands_pool;
+
+	guint batch_depth;
+	guint n_visible_snippets_groups;
 };
 
 
@@ -146,18 +213,348 @@ static GtkTreePath *
 get_tree_path_for_snippet (SnippetsDB *snippets_db,
                            AnjutaSnippet *snippet);
 
-static gchar *
-get_snippet_key_from_trigger_and_language (const gchar *trigger_key,
-                                           const gchar *language)
+static AnjutaSnippet *
+lookup_snippet_in_hash_table (SnippetsDB *snippets_db,
+                              const gchar *trigger_key,
+                              const gchar *language)
 {
-	gchar *snippet_key = NULL;
-	
-	/* Assertions */
-	g_return_val_if_fail (trigger_key != NULL, NULL);
+	SnippetKey snippet_key;
+
+	if (!snippet_key_init (&snippet_key, trigger_key, language, FALSE))
+		return NULL;
+
+	return g_hash_table_lookup (snippets_db->priv->snippet_keys_map, &snippet_key);
+}
+
+/* Called after every change of the snippets or the groups. The readers holding
+   the old snapshot keep it until they unref it. */
+static void
+invalidate_snapshot (SnippetsDB *snippets_db)
+{
+	SnippetsDBPrivate *priv = snippets_db->priv;
+
+	priv->generation ++;
+	if (priv->snapshot != NULL)
+	{
+		snippets_db_snapshot_unref (priv->snapshot);
+		priv->snapshot = NULL;
+	}
+}
+
+static gint
+compare_snippets_pointers_by_trigger (gconstpointer a,
+                                      gconstpointer b)
+{
+	return strcmp (snippet_get_trigger_key (*(AnjutaSnippet **)a),
+	               snippet_get_trigger_key (*(AnjutaSnippet **)b));
+}
 
-	snippet_key = g_strconcat (trigger_key, ".", language, NULL);
+static void
+free_snippets_array (gpointer snippets_array)
+{
+	g_ptr_array_free ((GPtrArray *)snippets_array, TRUE);
+}
+
+/* Gets the index of the first snippet with the trigger-key not smaller than
+   trigger_key */
+static guint
+get_trigger_lower_bound (GPtrArray *language_snippets,
+                         const gchar *trigger_key)
+{
+	guint low = 0, high = language_snippets->len, middle = 0;
 
-	return snippet_key;
+	while (low < high)
+	{
+		middle = (low + high) / 2;
+		if (strcmp (snippet_get_trigger_key (g_ptr_array_index (language_snippets, middle)),
+		            trigger_key) < 0)
+			low = middle + 1;
+		else
+			high = middle;
+	}
+
+	return low;
+}
+
+static void
+add_snippet_to_language_index (SnippetsDB *snippets_db,
+                               AnjutaSnippet *snippet,
+                               GQuark language)
+{
+	SnippetsDBPrivate *priv = snippets_db->priv;
+	GPtrArray *language_snippets = NULL;
+	guint position = 0;
+
+	language_snippets = g_hash_table_lookup (priv->language_snippets_map,
+	                                         GUINT_TO_POINTER (language));
+	if (language_snippets == NULL)
+	{
+		language_snippets = g_ptr_array_new ();
+		g_hash_table_insert (priv->language_snippets_map,
+		                     GUINT_TO_POINTER (language),
+		                     language_snippets);
+	}
+
+	/* While in a batch, we just append it and sort the arrays on the next query */
+	g_ptr_array_add (language_snippets, snippet);
+	if (priv->batch_depth > 0 || priv->language_snippets_unsorted)
+	{
+		priv->language_snippets_unsorted = TRUE;
+		return;
+	}
+
+	position = get_trigger_lower_bound (language_snippets, snippet_get_trigger_key (snippet));
+	if (position < language_snippets->len - 1)
+	{
+		g_memmove (&language_snippets->pdata[position + 1],
+		           &language_snippets->pdata[position],
+		           (language_snippets->len - position - 1) * sizeof (gpointer));
+		language_snippets->pdata[position] = snippet;
+	}
+}
+
+static void
+remove_snippet_from_language_index (SnippetsDB *snippets_db,
+                                    AnjutaSnippet *snippet,
+                                    GQuark language)
+{
+	SnippetsDBPrivate *priv = snippets_db->priv;
+	GPtrArray *language_snippets = NULL;
+	guint position = 0;
+
+	language_snippets = g_hash_table_lookup (priv->language_snippets_map,
+	                                         GUINT_TO_POINTER (language));
+	if (language_snippets == NULL)
+		return;
+
+	if (priv->language_snippets_unsorted)
+	{
+		g_ptr_array_remove (language_snippets, snippet);
+		return;
+	}
+
+	for (position = get_trigger_lower_bound (language_snippets, snippet_get_trigger_key (snippet));
+	     position < language_snippets->len;
+	     position ++)
+	{
+		if (g_ptr_array_index (language_snippets, position) == snippet)
+		{
+			g_ptr_array_remove_index (language_snippets, position);
+			return;
+		}
+	}
+}
+
+static void
+sort_language_index (SnippetsDB *snippets_db)
+{
+	SnippetsDBPrivate *priv = snippets_db->priv;
+	GHashTableIter iter;
+	gpointer language_snippets = NULL;
+
+	if (!priv->language_snippets_unsorted)
+		return;
+
+	g_hash_table_iter_init (&iter, priv->language_snippets_map);
+	while (g_hash_table_iter_next (&iter, NULL, &language_snippets))
+		g_ptr_array_sort ((GPtrArray *)language_snippets, compare_snippets_pointers_by_trigger);
+
+	priv->language_snippets_unsorted = FALSE;
+}
+
+static gint
+compare_pointers (gconstpointer a,
+                  gconstpointer b)
+{
+	gconstpointer pointer1 = *(gconstpointer *)a,
+	              pointer2 = *(gconstpointer *)b;
+
+	if (pointer1 < pointer2)
+		return -1;
+
+	return (pointer1 > pointer2);
+}
+
+/* Gets the index of the first pointer in the sorted array not smaller than pointer */
+static guint
+get_pointer_lower_bound (GPtrArray *pointers,
+                         gconstpointer pointer)
+{
+	guint low = 0, high = pointers->len, middle = 0;
+
+	while (low < high)
+	{
+		middle = (low + high) / 2;
+		if ((gconstpointer)g_ptr_array_index (pointers, middle) < pointer)
+			low = middle + 1;
+		else
+			high = middle;
+	}
+
+	return low;
+}
+
+static void
+add_trigrams_of_string (GHashTable *trigrams,
+                        const gchar *string)
+{
+	gsize i = 0, len = 0;
+
+	if (string == NULL)
+		return;
+
+	len = strlen (string);
+	for (i = 0; i + TRIGRAM_LENGTH <= len; i ++)
+		g_hash_table_insert (trigrams, TRIGRAM_KEY (string + i), NULL);
+}
+
+/* Gets the set of distinct trigrams of the lower-cased fields the provider searches in */
+static GHashTable *
+get_snippet_trigrams (AnjutaSnippet *snippet)
+{
+	GHashTable *trigrams = NULL;
+	const gchar* const* keywords = NULL;
+	gint i = 0;
+
+	trigrams = g_hash_table_new (g_direct_hash, g_direct_equal);
+
+	add_trigrams_of_string (trigrams, snippet_get_search_trigger_key (snippet));
+	add_trigrams_of_string (trigrams, snippet_get_search_name (snippet));
+
+	keywords = snippet_get_search_keywords (snippet);
+	for (i = 0; keywords != NULL && keywords[i] != NULL; i ++)
+		add_trigrams_of_string (trigrams, keywords[i]);
+
+	return trigrams;
+}
+
+static void
+add_snippet_to_trigram_index (SnippetsDB *snippets_db,
+                              AnjutaSnippet *snippet)
+{
+	SnippetsDBPrivate *priv = snippets_db->priv;
+	GHashTable *trigrams = NULL;
+	GHashTableIter iter;
+	gpointer trigram = NULL;
+	GPtrArray *trigram_snippets = NULL;
+	guint position = 0;
+
+	trigrams = get_snippet_trigrams (snippet);
+
+	g_hash_table_iter_init (&iter, trigrams);
+	while (g_hash_table_iter_next (&iter, &trigram, NULL))
+	{
+		trigram_snippets = g_hash_table_lookup (priv->trigram_snippets_map, trigram);
+		if (trigram_snippets == NULL)
+		{
+			trigram_snippets = g_ptr_array_new ();
+			g_hash_table_insert (priv->trigram_snippets_map, trigram, trigram_snippets);
+		}
+
+		/* While in a batch, we just append it and sort the arrays on the next query */
+		g_ptr_array_add (trigram_snippets, snippet);
+		if (priv->batch_depth > 0 || priv->trigram_snippets_unsorted)
+		{
+			priv->trigram_snippets_unsorted = TRUE;
+			continue;
+		}
+
+		position = get_pointer_lower_bound (trigram_snippets, snippet);
+		if (position < trigram_snippets->len - 1)
+		{
+			g_memmove (&trigram_snippets->pdata[position + 1],
+			           &trigram_snippets->pdata[position],
+			           (trigram_snippets->len - position - 1) * sizeof (gpointer));
+			trigram_snippets->pdata[position] = snippet;
+		}
+	}
+
+	g_hash_table_destroy (trigrams);
+}
+
+static void
+remove_snippet_from_trigram_index (SnippetsDB *snippets_db,
+                                   AnjutaSnippet *snippet)
+{
+	SnippetsDBPrivate *priv = snippets_db->priv;
+	GHashTable *trigrams = NULL;
+	GHashTableIter iter;
+	gpointer trigram = NULL;
+	GPtrArray *trigram_snippets = NULL;
+	guint position = 0;
+
+	trigrams = get_snippet_trigrams (snippet);
+
+	g_hash_table_iter_init (&iter, trigrams);
+	while (g_hash_table_iter_next (&iter, &trigram, NULL))
+	{
+		trigram_snippets = g_hash_table_lookup (priv->trigram_snippets_map, trigram);
+		if (trigram_snippets == NULL)
+			continue;
+
+		if (priv->trigram_snippets_unsorted)
+		{
+			g_ptr_array_remove (trigram_snippets, snippet);
+			continue;
+		}
+
+		position = get_pointer_lower_bound (trigram_snippets, snippet);
+		if (position < trigram_snippets->len &&
+		    g_ptr_array_index (trigram_snippets, position) == snippet)
+			g_ptr_array_remove_index (trigram_snippets, position);
+	}
+
+	g_hash_table_destroy (trigrams);
+}
+
+static void
+sort_trigram_index (SnippetsDB *snippets_db)
+{
+	SnippetsDBPrivate *priv = snippets_db->priv;
+	GHashTableIter iter;
+	gpointer trigram_snippets = NULL;
+
+	if (!priv->trigram_snippets_unsorted)
+		return;
+
+	g_hash_table_iter_init (&iter, priv->trigram_snippets_map);
+	while (g_hash_table_iter_next (&iter, NULL, &trigram_snippets))
+		g_ptr_array_sort ((GPtrArray *)trigram_snippets, compare_pointers);
+
+	priv->trigram_snippets_unsorted = FALSE;
+}
+
+/* Keeps in result only the snippets also found in trigram_snippets. Both are
+   sorted by address. */
+static void
+intersect_sorted_snippets (GPtrArray *result,
+                           GPtrArray *trigram_snippets)
+{
+	guint i = 0, j = 0, n_kept = 0;
+	gpointer cur_snippet = NULL;
+
+	while (i < result->len && j < trigram_snippets->len)
+	{
+		cur_snippet = g_ptr_array_index (result, i);
+
+		if ((gconstpointer)g_ptr_array_index (trigram_snippets, j) < (gconstpointer)cur_snippet)
+			j ++;
+		else
+		{
+			if (g_ptr_array_index (trigram_snippets, j) == cur_snippet)
+				result->pdata[n_kept ++] = cur_snippet;
+			i ++;
+		}
+	}
+
+	g_ptr_array_set_size (result, n_kept);
+}
+
+static gint
+compare_ptr_arrays_by_length (gconstpointer a,
+                              gconstpointer b)
+{
+	return (gint)(*(GPtrArray **)a)->len - (gint)(*(GPtrArray **)b)->len;
 }
 
 static void
@@ -165,7 +562,7 @@ add_snippet_to_hash_table (SnippetsDB *snippets_db,
                            AnjutaSnippet *snippet)
 {
 	GList *iter = NULL, *languages = NULL;
-	gchar *snippet_key = NULL;
+	SnippetKey snippet_key;
 	const gchar *trigger_key = NULL, *lang = NULL;
 	SnippetsDBPrivate *priv = NULL;
 
@@ -181,12 +578,16 @@ add_snippet_to_hash_table (SnippetsDB *snippets_db,
 	{
 		lang = (const gchar *)iter->data;
 		
-		snippet_key = get_snippet_key_from_trigger_and_language (trigger_key, lang);
-
-		g_hash_table_insert (priv->snippet_keys_map, snippet_key, snippet);
+		if (!snippet_key_init (&snippet_key, trigger_key, lang, TRUE))
+			continue;
 
+		g_hash_table_insert (priv->snippet_keys_map,
+		                     g_slice_dup (SnippetKey, &snippet_key),
+		                     snippet);
+		add_snippet_to_language_index (snippets_db, snippet, snippet_key.language);
 	}
 
+	add_snippet_to_trigram_index (snippets_db, snippet);
 }
 
 static void
@@ -194,7 +595,8 @@ remove_snippet_from_hash_table (SnippetsDB *snippets_db,
                                 AnjutaSnippet *snippet)
 {
 	GList *languages = NULL, *iter = NULL;
-	gchar *cur_language = NULL, *cur_snippet_key = NULL, *trigger_key = NULL;
+	gchar *cur_language = NULL, *trigger_key = NULL;
+	SnippetKey cur_snippet_key;
 	
 	/* Assertions */
 	g_return_if_fail (ANJUTA_IS_SNIPPETS_DB (snippets_db));
@@ -206,33 +608,32 @@ remove_snippet_from_hash_table (SnippetsDB *snippets_db,
 	for (iter = g_list_first (languages); iter != NULL; iter = g_list_next (iter))
 	{
 		cur_language = (gchar *)iter->data;
-		cur_snippet_key = get_snippet_key_from_trigger_and_language (trigger_key, cur_language);
-
-		if (cur_snippet_key == NULL)
+		if (!snippet_key_init (&cur_snippet_key, trigger_key, cur_language, FALSE))
 			continue;
 
-		g_hash_table_remove (snippets_db->priv->snippet_keys_map, cur_snippet_key);
+		g_hash_table_remove (snippets_db->priv->snippet_keys_map, &cur_snippet_key);
+		remove_snippet_from_language_index (snippets_db, snippet, cur_snippet_key.language);
 	}
+
+	remove_snippet_from_trigram_index (snippets_db, snippet);
 }
 
 static void
 remove_snippets_group_from_hash_table (SnippetsDB *snippets_db,
                                        AnjutaSnippetsGroup *snippets_group)
 {
-	GList *snippets = NULL, *iter = NULL;
 	AnjutaSnippet *cur_snippet = NULL;
+	guint i = 0;
 
 	/* Assertions */
 	g_return_if_fail (ANJUTA_IS_SNIPPETS_DB (snippets_db));
 	g_return_if_fail (ANJUTA_IS_SNIPPETS_GROUP (snippets_group));
 
-	snippets = (GList *)snippets_group_get_snippets_list (snippets_group);
-
 	/* Iterate over all the snippets in the group, and remove all the snippet keys
 	   a snippet has stored. */
-	for (iter = g_list_first (snippets); iter != NULL; iter = g_list_next (iter))
+	for (i = 0; i < snippets_group_get_n_snippets (snippets_group); i ++)
 	{
-		cur_snippet = (AnjutaSnippet *)iter->data;
+		cur_snippet = snippets_group_get_nth_snippet (snippets_group, i);
 		g_return_if_fail (ANJUTA_IS_SNIPPET (cur_snippet));
 
 		remove_snippet_from_hash_table (snippets_db, cur_snippet);
@@ -287,6 +688,21 @@ copy_default_files_to_user_folder (SnippetsDB *snippets_db)
 
 }
 
+static void
+add_global_variable_to_hash_table (SnippetsDB *snippets_db,
+                                   const gchar *variable_name,
+                                   GtkTreeIter *iter)
+{
+	/* Assertions */
+	g_return_if_fail (ANJUTA_IS_SNIPPETS_DB (snippets_db));
+	g_return_if_fail (variable_name != NULL);
+	g_return_if_fail (iter != NULL);
+
+	g_hash_table_insert (snippets_db->priv->global_variables_map,
+	                     g_strdup (variable_name),
+	                     gtk_tree_iter_copy (iter));
+}
+
 static void
 load_internal_global_variables (SnippetsDB *snippets_db)
 {
@@ -307,6 +723,7 @@ load_internal_global_variables (SnippetsDB *snippets_db)
 	                    GLOBAL_VARS_MODEL_COL_IS_COMMAND, FALSE,
 	                    GLOBAL_VARS_MODEL_COL_IS_INTERNAL, TRUE,
 	                    -1);
+	add_global_variable_to_hash_table (snippets_db, GLOBAL_VAR_FILE_NAME, &iter_added);
 
 	/* Add the username global variable */
 	gtk_list_store_prepend (global_vars_store, &iter_added);
@@ -316,6 +733,7 @@ load_internal_global_variables (SnippetsDB *snippets_db)
 	                    GLOBAL_VARS_MODEL_COL_IS_COMMAND, FALSE,
 	                    GLOBAL_VARS_MODEL_COL_IS_INTERNAL, TRUE,
 	                    -1);
+	add_global_variable_to_hash_table (snippets_db, GLOBAL_VAR_USER_NAME, &iter_added);
 
 	/* Add the userfullname global variable */
 	gtk_list_store_prepend (global_vars_store, &iter_added);
@@ -325,6 +743,7 @@ load_internal_global_variables (SnippetsDB *snippets_db)
 	                    GLOBAL_VARS_MODEL_COL_IS_COMMAND, FALSE,
 	                    GLOBAL_VARS_MODEL_COL_IS_INTERNAL, TRUE,
 	                    -1);
+	add_global_variable_to_hash_table (snippets_db, GLOBAL_VAR_USER_FULL_NAME, &iter_added);
 
 	/* Add the hostname global variable*/
 	gtk_list_store_prepend (global_vars_store, &iter_added);
@@ -334,6 +753,7 @@ load_internal_global_variables (SnippetsDB *snippets_db)
 	                    GLOBAL_VARS_MODEL_COL_IS_COMMAND, FALSE,
 	                    GLOBAL_VARS_MODEL_COL_IS_INTERNAL, TRUE,
 	                    -1);
+	add_global_variable_to_hash_table (snippets_db, GLOBAL_VAR_HOST_NAME, &iter_added);
 }
 
 static void
@@ -423,36 +843,17 @@ get_internal_global_variable_value (AnjutaShell *shell,
 	return NULL;
 }
 
+/* The returned iter is owned by the hash-table and shouldn't be freed */
 static GtkTreeIter*
-get_iter_at_global_variable_name (GtkListStore *global_vars_store,
+get_iter_at_global_variable_name (SnippetsDB *snippets_db,
                                   const gchar *variable_name)
 {
-	GtkTreeIter iter;
-	gchar *stored_name = NULL;
-	gboolean iter_is_set = FALSE;
-	
 	/* Assertions */
-	g_return_val_if_fail (GTK_IS_LIST_STORE (global_vars_store), NULL);
-
-	iter_is_set = gtk_tree_model_get_iter_first (GTK_TREE_MODEL (global_vars_store), &iter);
-	while (iter_is_set) 
-	{
-		gtk_tree_model_get (GTK_TREE_MODEL (global_vars_store), &iter,
-		                    GLOBAL_VARS_MODEL_COL_NAME, &stored_name, 
-		                    -1);
-
-		/* If we found the name in the database */
-		if (!g_strcmp0 (stored_name, variable_name) )
-		{
-			g_free (stored_name);
-			return gtk_tree_iter_copy (&iter);
-		}
+	g_return_val_if_fail (ANJUTA_IS_SNIPPETS_DB (snippets_db), NULL);
+	if (variable_name == NULL)
+		return NULL;
 
-		iter_is_set = gtk_tree_model_iter_next (GTK_TREE_MODEL (global_vars_store), &iter);
-		g_free (stored_name);
-	}
-	
-	return NULL;
+	return g_hash_table_lookup (snippets_db->priv->global_variables_map, variable_name);
 }
 
 static gint
@@ -470,6 +871,92 @@ compare_snippets_groups_by_name (gconstpointer a,
 	                       snippets_group_get_name (group2));
 }
 
+static gint
+compare_snippets_groups_pointers_by_name (gconstpointer a,
+                                          gconstpointer b)
+{
+	return compare_snippets_groups_by_name (*(AnjutaSnippetsGroup **)a,
+	                                        *(AnjutaSnippetsGroup **)b);
+}
+
+static guint
+get_n_visible_snippets_groups (SnippetsDB *snippets_db)
+{
+	SnippetsDBPrivate *priv = snippets_db->priv;
+
+	if (priv->batch_depth > 0)
+		return priv->n_visible_snippets_groups;
+
+	return priv->snippets_groups->len;
+}
+
+static void
+invalidate_snippets_groups_positions (SnippetsDB *snippets_db,
+                                      guint start_position)
+{
+	SnippetsDBPrivate *priv = snippets_db->priv;
+
+	if (priv->stale_groups_positions_start < 0 ||
+	    start_position < (guint)priv->stale_groups_positions_start)
+		priv->stale_groups_positions_start = start_position;
+}
+
+static void
+update_snippets_groups_positions (SnippetsDB *snippets_db)
+{
+	SnippetsDBPrivate *priv = snippets_db->priv;
+	guint i = 0;
+
+	if (priv->stale_groups_positions_start < 0)
+		return;
+
+	for (i = priv->stale_groups_positions_start; i < priv->snippets_groups->len; i ++)
+		((AnjutaSnippetsGroup *)g_ptr_array_index (priv->snippets_groups, i))->position = i;
+	priv->stale_groups_positions_start = -1;
+}
+
+/* The position of a group stored in the database, brought up to date if needed */
+static gint
+get_snippets_group_position (SnippetsDB *snippets_db,
+                             AnjutaSnippetsGroup *snippets_group)
+{
+	update_snippets_groups_positions (snippets_db);
+
+	return snippets_group->position;
+}
+
+/* The position of the snippet in its group or -1 if it isn't stored in one */
+static gint
+get_snippet_position (AnjutaSnippet *snippet)
+{
+	if (!ANJUTA_IS_SNIPPETS_GROUP (snippet->parent_snippets_group))
+		return -1;
+
+	return snippets_group_get_snippet_position (ANJUTA_SNIPPETS_GROUP (snippet->parent_snippets_group),
+	                                            snippet);
+}
+
+static guint
+get_insert_position_for_snippets_group (SnippetsDB *snippets_db,
+                                        AnjutaSnippetsGroup *snippets_group)
+{
+	GPtrArray *snippets_groups = snippets_db->priv->snippets_groups;
+	guint low = 0, high = snippets_groups->len, middle = 0;
+
+	/* Binary search for the first group which comes after the given one */
+	while (low < high)
+	{
+		middle = (low + high) / 2;
+		if (compare_snippets_groups_by_name (g_ptr_array_index (snippets_groups, middle),
+		                                     snippets_group) <= 0)
+			low = middle + 1;
+		else
+			high = middle;
+	}
+
+	return low;
+}
+
 static void
 snippets_db_dispose (GObject* obj)
 {
@@ -484,11 +971,26 @@ snippets_db_dispose (GObject* obj)
 	snippets_db = ANJUTA_SNIPPETS_DB (obj);
 	g_return_if_fail (snippets_db->priv != NULL);
 	
-	g_list_free (snippets_db->priv->snippets_groups);
+	g_ptr_array_free (snippets_db->priv->snippets_groups, TRUE);
 	g_hash_table_destroy (snippets_db->priv->snippet_keys_map);
-
-	snippets_db->priv->snippets_groups   = NULL;
-	snippets_db->priv->snippet_keys_map  = NULL;
+	g_hash_table_destroy (snippets_db->priv->snippets_groups_map);
+	g_hash_table_destroy (snippets_db->priv->global_variables_map);
+	g_hash_table_destroy (snippets_db->priv->language_snippets_map);
+	g_hash_table_destroy (snippets_db->priv->trigram_snippets_map);
+	if (snippets_db->priv->snapshot != NULL)
+		snippets_db_snapshot_unref (snippets_db->priv->snapshot);
+	/* No command is pending, as the callers wait for theirs */
+	if (snippets_db->priv->commands_pool != NULL)
+		g_thread_pool_free (snippets_db->priv->commands_pool, FALSE, TRUE);
+
+	snippets_db->priv->snippets_groups      = NULL;
+	snippets_db->priv->snippet_keys_map     = NULL;
+	snippets_db->priv->snippets_groups_map  = NULL;
+	snippets_db->priv->global_variables_map = NULL;
+	snippets_db->priv->snapshot             = NULL;
+	snippets_db->priv->commands_pool        = NULL;
+	snippets_db->priv->language_snippets_map = NULL;
+	snippets_db->priv->trigram_snippets_map = NULL;
 	
 	G_OBJECT_CLASS (snippets_db_parent_class)->dispose (obj);
 }
@@ -537,16 +1039,41 @@ snippets_db_init (SnippetsDB *snippets_db)
 	snippets_db->stamp = g_random_int ();
 
 	/* Initialize the private fields */
-	snippets_db->priv->snippets_groups = NULL;
-	snippets_db->priv->snippet_keys_map = g_hash_table_new_full (g_str_hash, 
-	                                                             g_str_equal, 
-	                                                             g_free, 
+	snippets_db->priv->snippets_groups = g_ptr_array_new ();
+	snippets_db->priv->stale_groups_positions_start = -1;
+	snippets_db->priv->snippet_keys_map = g_hash_table_new_full (snippet_key_hash, 
+	                                                             snippet_key_equal, 
+	                                                             snippet_key_free, 
 	                                                             NULL);
+	snippets_db->priv->snippets_groups_map = g_hash_table_new_full (g_str_hash,
+	                                                                g_str_equal,
+	                                                                g_free,
+	                                                                NULL);
 	snippets_db->priv->global_variables = gtk_list_store_new (GLOBAL_VARS_MODEL_COL_N,
 	                                                          G_TYPE_STRING,
 	                                                          G_TYPE_STRING,
 	                                                          G_TYPE_BOOLEAN,
 	                                                          G_TYPE_BOOLEAN);
+	snippets_db->priv->global_variables_map = g_hash_table_new_full (g_str_hash,
+	                                                                 g_str_equal,
+	                                                                 g_free,
+	                                                                 (GDestroyNotify)gtk_tree_iter_free);
+	snippets_db->priv->language_snippets_map = g_hash_table_new_full (g_direct_hash,
+	                                                                  g_direct_equal,
+	                                                                  NULL,
+	                                                                  free_snippets_array);
+	snippets_db->priv->language_snippets_unsorted = FALSE;
+	snippets_db->priv->trigram_snippets_map = g_hash_table_new_full (g_direct_hash,
+	                                                                 g_direct_equal,
+	                                                                 NULL,
+	                                                                 free_snippets_array);
+	snippets_db->priv->trigram_snippets_unsorted = FALSE;
+	snippets_db->priv->current_language = NULL;
+	snippets_db->priv->generation = 0;
+	snippets_db->priv->snapshot = NULL;
+	snippets_db->priv->commands_pool = NULL;
+	snippets_db->priv->batch_depth = 0;
+	snippets_db->priv->n_visible_snippets_groups = 0;
 }
 
 /* SnippetsDB public methods */
@@ -589,7 +1116,9 @@ snippets_db_load (SnippetsDB *snippets_db)
 
 	/* Load the snippets and global variables */
 	load_global_variables (snippets_db);
+	snippets_db_begin_batch (snippets_db);
 	load_snippets (snippets_db);
+	snippets_db_end_batch (snippets_db);
 }
 
 /**
@@ -603,7 +1132,6 @@ snippets_db_load (SnippetsDB *snippets_db)
 void                       
 snippets_db_close (SnippetsDB *snippets_db)
 {
-	GList *iter = NULL;
 	AnjutaSnippetsGroup *cur_snippets_group = NULL;
 	SnippetsDBPrivate *priv = NULL;
 	GtkTreePath *path = NULL;
@@ -613,49 +1141,185 @@ snippets_db_close (SnippetsDB *snippets_db)
 	g_return_if_fail (snippets_db->priv != NULL);
 	priv = ANJUTA_SNIPPETS_DB_GET_PRIVATE (snippets_db);
 
-	/* Free the memory for the snippets-groups in the SnippetsDB */
-	for (iter = g_list_first (priv->snippets_groups); iter != NULL; iter = g_list_next (iter))
+	/* Free the memory for the snippets-groups in the SnippetsDB. We go backwards, so
+	   the path of each deleted group is still valid when the signal is emitted. */
+	while (priv->snippets_groups->len > 0)
 	{
-		cur_snippets_group = (AnjutaSnippetsGroup *)iter->data;
+		cur_snippets_group = g_ptr_array_index (priv->snippets_groups,
+		                                        priv->snippets_groups->len - 1);
 		g_return_if_fail (ANJUTA_IS_SNIPPETS_GROUP (cur_snippets_group));
 
-		/* Emit the signal that the snippet was deleted */
 		path = get_tree_path_for_snippets_group (snippets_db, cur_snippets_group);
-		gtk_tree_model_row_deleted (GTK_TREE_MODEL (snippets_db), path);
+		g_ptr_array_remove_index (priv->snippets_groups, priv->snippets_groups->len - 1);
+		cur_snippets_group->position = -1;
+
+		/* Emit the signal that the snippets group was deleted. While in a batch the
+		   rows are already hidden. */
+		if (priv->batch_depth == 0)
+			gtk_tree_model_row_deleted (GTK_TREE_MODEL (snippets_db), path);
 		gtk_tree_path_free (path);
 
 		g_object_unref (cur_snippets_group);
 
 	}
-	g_list_free (priv->snippets_groups);
-	priv->snippets_groups = NULL;
 
 	/* Unload the global variables */
 	gtk_list_store_clear (priv->global_variables);
+	g_hash_table_remove_all (priv->global_variables_map);
 
 	/* Free the hash-table memory */
 	g_hash_table_ref (priv->snippet_keys_map);
 	g_hash_table_destroy (priv->snippet_keys_map);
+	g_hash_table_ref (priv->snippets_groups_map);
+	g_hash_table_destroy (priv->snippets_groups_map);
+	g_hash_table_ref (priv->language_snippets_map);
+	g_hash_table_destroy (priv->language_snippets_map);
+	priv->language_snippets_unsorted = FALSE;
+	g_hash_table_ref (priv->trigram_snippets_map);
+	g_hash_table_destroy (priv->trigram_snippets_map);
+	priv->trigram_snippets_unsorted = FALSE;
+
+	invalidate_snapshot (snippets_db);
+}
+
+/**
+ * snippets_db_set_current_language:
+ * @snippets_db: A #SnippetsDB object.
+ * @language: The language of the current document or NULL if there isn't a current
+ *            editor.
+ *
+ * Caches the language of the current document, so the components reading it don't
+ * have to ask the editor every time.
+ */
+void
+snippets_db_set_current_language (SnippetsDB *snippets_db,
+                                  const gchar *language)
+{
+	/* Assertions */
+	g_return_if_fail (ANJUTA_IS_SNIPPETS_DB (snippets_db));
+
+	snippets_db->priv->current_language = g_intern_string (language);
+}
+
+/**
+ * snippets_db_get_current_language:
+ * @snippets_db: A #SnippetsDB object.
+ *
+ * Returns: The cached language of the current document (an interned string, it
+ *          shouldn't be freed) or NULL if there isn't a current editor.
+ */
+const gchar *
+snippets_db_get_current_language (SnippetsDB *snippets_db)
+{
+	/* Assertions */
+	g_return_val_if_fail (ANJUTA_IS_SNIPPETS_DB (snippets_db), NULL);
+
+	return snippets_db->priv->current_language;
+}
+
+/**
+ * snippets_db_begin_batch:
+ * @snippets_db: A #SnippetsDB object.
+ *
+ * Starts a batch of changes, for example when importing many snippets. Until the
+ * matching #snippets_db_end_batch call, the #GtkTreeModel appears empty and the
+ * snippets and groups added or removed don't emit any row signals. Batches can be
+ * nested.
+ */
+void
+snippets_db_begin_batch (SnippetsDB *snippets_db)
+{
+	SnippetsDBPrivate *priv = NULL;
+	GtkTreePath *path = NULL;
 
+	/* Assertions */
+	g_return_if_fail (ANJUTA_IS_SNIPPETS_DB (snippets_db));
+	priv = ANJUTA_SNIPPETS_DB_GET_PRIVATE (snippets_db);
+
+	priv->batch_depth ++;
+	if (priv->batch_depth > 1)
+		return;
+
+	/* Hide the rows from the views, going backwards so the paths stay valid */
+	priv->n_visible_snippets_groups = priv->snippets_groups->len;
+	while (priv->n_visible_snippets_groups > 0)
+	{
+		priv->n_visible_snippets_groups --;
+		path = gtk_tree_path_new_from_indices (priv->n_visible_snippets_groups, -1);
+		gtk_tree_model_row_deleted (GTK_TREE_MODEL (snippets_db), path);
+		gtk_tree_path_free (path);
+	}
+}
+
+/**
+ * snippets_db_end_batch:
+ * @snippets_db: A #SnippetsDB object.
+ *
+ * Ends a batch of changes started with #snippets_db_begin_batch. When the outermost
+ * batch ends, the groups are sorted once and the rows are inserted back in the
+ * #GtkTreeModel.
+ */
+void
+snippets_db_end_batch (SnippetsDB *snippets_db)
+{
+	SnippetsDBPrivate *priv = NULL;
+	AnjutaSnippetsGroup *cur_snippets_group = NULL;
+	GtkTreePath *path = NULL;
+	GtkTreeIter tree_iter;
+
+	/* Assertions */
+	g_return_if_fail (ANJUTA_IS_SNIPPETS_DB (snippets_db));
+	priv = ANJUTA_SNIPPETS_DB_GET_PRIVATE (snippets_db);
+	g_return_if_fail (priv->batch_depth > 0);
+
+	if (priv->batch_depth > 1)
+	{
+		priv->batch_depth --;
+		return;
+	}
+
+	/* The groups added in the batch were appended, so we sort them now */
+	g_ptr_array_sort (priv->snippets_groups, compare_snippets_groups_pointers_by_name);
+	invalidate_snippets_groups_positions (snippets_db, 0);
+
+	/* Show the rows back. The snippets are loaded by the views when they expand
+	   a group. */
+	while (priv->n_visible_snippets_groups < priv->snippets_groups->len)
+	{
+		cur_snippets_group = g_ptr_array_index (priv->snippets_groups,
+		                                        priv->n_visible_snippets_groups);
+		priv->n_visible_snippets_groups ++;
+
+		path = gtk_tree_path_new_from_indices (get_snippets_group_position (snippets_db,
+		                                                                    cur_snippets_group),
+		                                       -1);
+		snippets_db_get_iter (GTK_TREE_MODEL (snippets_db), &tree_iter, path);
+		gtk_tree_model_row_inserted (GTK_TREE_MODEL (snippets_db), path, &tree_iter);
+		if (snippets_group_get_n_snippets (cur_snippets_group) > 0)
+			gtk_tree_model_row_has_child_toggled (GTK_TREE_MODEL (snippets_db), path, &tree_iter);
+		gtk_tree_path_free (path);
+	}
+
+	priv->batch_depth = 0;
 }
 
 void
 snippets_db_debug (SnippetsDB *snippets_db)
 {
 	SnippetsDBPrivate *priv = ANJUTA_SNIPPETS_DB_GET_PRIVATE (snippets_db);
-	GList *iter = NULL, *iter2 = NULL;
+	guint i = 0, j = 0;
 
-	for (iter = g_list_first (priv->snippets_groups); iter != NULL; iter = g_list_next (iter))
+	for (i = 0; i < priv->snippets_groups->len; i ++)
 	{
-		if (ANJUTA_IS_SNIPPETS_GROUP (iter->data))
+		if (ANJUTA_IS_SNIPPETS_GROUP (g_ptr_array_index (priv->snippets_groups, i)))
 		{
-			AnjutaSnippetsGroup *group = ANJUTA_SNIPPETS_GROUP (iter->data);
+			AnjutaSnippetsGroup *group = ANJUTA_SNIPPETS_GROUP (g_ptr_array_index (priv->snippets_groups, i));
 			printf ("%s\n", snippets_group_get_name (group));
-			for (iter2 = g_list_first (snippets_group_get_snippets_list (group)); iter2 != NULL; iter2 = g_list_next (iter2))
+			for (j = 0; j < snippets_group_get_n_snippets (group); j ++)
 			{
-				if (ANJUTA_IS_SNIPPET (iter2->data))
+				if (ANJUTA_IS_SNIPPET (snippets_group_get_nth_snippet (group, j)))
 				{
-					AnjutaSnippet *s = ANJUTA_SNIPPET (iter2->data);
+					AnjutaSnippet *s = snippets_group_get_nth_snippet (group, j);
 					printf ("\t[%s | %s | %s]\n", snippet_get_name (s), snippet_get_trigger_key (s), snippet_get_languages_string (s));
 				}
 				else
@@ -699,6 +1363,8 @@ snippets_db_save_snippets (SnippetsDB *snippets_db)
 {
 	SnippetsDBPrivate *priv = NULL;
 	gchar *user_file_path = NULL;
+	GList *snippets_groups = NULL;
+	gint i = 0;
 
 	/* Assertions */
 	g_return_if_fail (ANJUTA_IS_SNIPPETS_DB (snippets_db));
@@ -708,8 +1374,14 @@ snippets_db_save_snippets (SnippetsDB *snippets_db)
 		anjuta_util_get_user_data_file_path (USER_SNIPPETS_DB_DIR, "/", 
 		                                     DEFAULT_SNIPPETS_FILE, NULL);
 
-	snippets_manager_save_snippets_xml_file (NATIVE_FORMAT, priv->snippets_groups, user_file_path);
+	/* The XML writer takes a list of groups */
+	for (i = priv->snippets_groups->len - 1; i >= 0; i --)
+		snippets_groups = g_list_prepend (snippets_groups,
+		                                  g_ptr_array_index (priv->snippets_groups, i));
+
+	snippets_manager_save_snippets_xml_file (NATIVE_FORMAT, snippets_groups, user_file_path);
 
+	g_list_free (snippets_groups);
 	g_free (user_file_path);
 }
 
@@ -781,69 +1453,75 @@ snippets_db_add_snippet (SnippetsDB* snippets_db,
                          AnjutaSnippet* added_snippet,
                          const gchar* group_name)
 {
-	GList *iter = NULL;
-	AnjutaSnippetsGroup *cur_snippets_group = NULL;
-	const gchar *cur_snippets_group_name = NULL;
+	AnjutaSnippetsGroup *snippets_group = NULL;
 	GtkTreePath *path;
 	GtkTreeIter tree_iter;
-	SnippetsDBPrivate *priv = NULL;
 	
 	/* Assertions */
 	g_return_val_if_fail (ANJUTA_IS_SNIPPETS_DB (snippets_db), FALSE);
 	g_return_val_if_fail (ANJUTA_IS_SNIPPET (added_snippet), FALSE);
-	priv = ANJUTA_SNIPPETS_DB_GET_PRIVATE (snippets_db);
 
 	/* Check that the snippet is not conflicting */
 	if (snippets_db_has_snippet (snippets_db, added_snippet))
 		return FALSE;
 
 	/* Lookup the AnjutaSnippetsGroup with the given group_name */
-	for (iter = g_list_first (priv->snippets_groups); iter != NULL; iter = g_list_next (iter))
-	{
-		cur_snippets_group = ANJUTA_SNIPPETS_GROUP (iter->data);
-		g_return_val_if_fail (ANJUTA_IS_SNIPPETS_GROUP (cur_snippets_group), FALSE);
-		cur_snippets_group_name = snippets_group_get_name (cur_snippets_group);
+	snippets_group = snippets_db_get_snippets_group (snippets_db, group_name);
+	if (!ANJUTA_IS_SNIPPETS_GROUP (snippets_group))
+		return FALSE;
 
-		/* We found the group */
-		if (!g_strcmp0 (cur_snippets_group_name, group_name))
-		{
-			/* Add the snippet to the group */
-			snippets_group_add_snippet (cur_snippets_group, added_snippet);
+	/* Add the snippet to the group */
+	snippets_group_add_snippet (snippets_group, added_snippet);
 
-			/* Add to the Hashtable */
-			add_snippet_to_hash_table (snippets_db, added_snippet);
+	/* Add to the Hashtable */
+	add_snippet_to_hash_table (snippets_db, added_snippet);
+	invalidate_snapshot (snippets_db);
 
-			/* Emit the signal that the database was changed */
-			path = get_tree_path_for_snippet (snippets_db, added_snippet);
-			snippets_db_get_iter (GTK_TREE_MODEL (snippets_db), &tree_iter, path);
-			gtk_tree_model_row_inserted (GTK_TREE_MODEL (snippets_db), path, &tree_iter);
-			gtk_tree_path_free (path);
-			return TRUE;
-		}
-	}
-	
-	return FALSE;
+	/* While in a batch, the rows are inserted when it ends */
+	if (snippets_db->priv->batch_depth > 0)
+		return TRUE;
+
+	/* Emit the signal that the database was changed */
+	path = get_tree_path_for_snippet (snippets_db, added_snippet);
+	snippets_db_get_iter (GTK_TREE_MODEL (snippets_db), &tree_iter, path);
+	gtk_tree_model_row_inserted (GTK_TREE_MODEL (snippets_db), path, &tree_iter);
+	gtk_tree_path_free (path);
+
+	return TRUE;
 }
 
 
+/**
+ * snippets_db_has_snippet:
+ * @snippets_db: A #SnippetsDB object.
+ * @snippet: A #AnjutaSnippet object.
+ *
+ * Checks if the database has a snippet conflicting with @snippet, meaning a snippet
+ * with the same trigger-key and at least one common language. The check is answered
+ * from the snippet-key hash table, so it doesn't depend on the size of the database.
+ *
+ * Returns: TRUE if there is a conflicting snippet in the database.
+ **/
 gboolean
 snippets_db_has_snippet (SnippetsDB *snippets_db,
                          AnjutaSnippet *snippet)
 {
-	GtkTreePath *path = NULL;
+	GList *iter = NULL;
+	const gchar *trigger_key = NULL;
+	gboolean found = FALSE;
 
 	/* Assertions */
 	g_return_val_if_fail (ANJUTA_IS_SNIPPETS_DB (snippets_db), FALSE);
 	g_return_val_if_fail (ANJUTA_IS_SNIPPET (snippet), FALSE);
-	
-	path = get_tree_path_for_snippet (snippets_db, snippet);
-	if (path != NULL)
+
+	trigger_key = snippet_get_trigger_key (snippet);
+	for (iter = (GList *)snippet_get_languages (snippet); iter != NULL && !found; iter = g_list_next (iter))
 	{
-		gtk_tree_path_free (path);
-		return TRUE;
+		found = (lookup_snippet_in_hash_table (snippets_db, trigger_key,
+		                                       (const gchar *)iter->data) != NULL);
 	}
 
-	return FALSE;
+	return found;
 }
 
 /**
@@ -862,9 +1540,6 @@ snippets_db_get_snippet (SnippetsDB* snippets_db,
                          const gchar* trigger_key,
                          const gchar* language)
 {
-	AnjutaSnippet *snippet = NULL;
-	gchar *snippet_key = NULL;
-	
 	/* Assertions */
 	g_return_val_if_fail (ANJUTA_IS_SNIPPETS_DB (snippets_db), NULL);
 	g_return_val_if_fail (trigger_key != NULL, NULL);
@@ -872,40 +1547,167 @@ snippets_db_get_snippet (SnippetsDB* snippets_db,
 	/* Get the editor language if not provided */
 	if (language == NULL)
 	{
-		IAnjutaDocumentManager *docman = NULL;
-		IAnjutaDocument *doc = NULL;
-		IAnjutaEditorLanguage *ieditor_language = NULL;
-		IAnjutaLanguage *ilanguage = NULL;
-		
-		docman = anjuta_shell_get_interface (snippets_db->anjuta_shell, 
-		                                     IAnjutaDocumentManager, 
-		                                     NULL);
-		ilanguage = anjuta_shell_get_interface (snippets_db->anjuta_shell,
-		                                        IAnjutaLanguage,
-		                                        NULL);
-		g_return_val_if_fail (IANJUTA_IS_DOCUMENT_MANAGER (docman), NULL);
-		g_return_val_if_fail (IANJUTA_IS_LANGUAGE (ilanguage), NULL);
-
-		/* Get the current doc and make sure it's an editor */
-		doc = ianjuta_document_manager_get_current_document (docman, NULL);
-		if (!IANJUTA_IS_EDITOR_LANGUAGE (doc))
+		language = snippets_db->priv->current_language;
+		if (language == NULL)
 			return NULL;
-		ieditor_language = IANJUTA_EDITOR_LANGUAGE (doc);
-		
+	}
 
-		language = ianjuta_language_get_name_from_editor (ilanguage, ieditor_language, NULL);
+	/* Look up the the snippet in the hashtable */
+	return lookup_snippet_in_hash_table (snippets_db, trigger_key, language);
+}
+
+/**
+ * snippets_db_get_snippets_for_language:
+ * @snippets_db: A #SnippetsDB object.
+ * @language: The language of the requested snippets.
+ * @trigger_prefix: The prefix the trigger-keys should start with. NULL or "" for all
+ *                  the snippets of the @language.
+ * @n_snippets: Will be set to the number of returned snippets.
+ *
+ * Lists the snippets supporting @language with the trigger-key starting with
+ * @trigger_prefix, sorted by trigger-key. It's answered from a per-language index
+ * in O(log n + k).
+ *
+ * Returns: An array of @n_snippets #AnjutaSnippet objects owned by the @snippets_db, or
+ *          NULL if there isn't any. It's only valid until the @snippets_db is changed.
+ */
+AnjutaSnippet**
+snippets_db_get_snippets_for_language (SnippetsDB *snippets_db,
+                                       const gchar *language,
+                                       const gchar *trigger_prefix,
+                                       guint *n_snippets)
+{
+	GPtrArray *language_snippets = NULL;
+	GQuark language_quark = 0;
+	guint start = 0, end = 0;
+
+	/* Assertions */
+	g_return_val_if_fail (ANJUTA_IS_SNIPPETS_DB (snippets_db), NULL);
+	g_return_val_if_fail (n_snippets != NULL, NULL);
+	*n_snippets = 0;
+
+	language_quark = g_quark_try_string (language);
+	if (language_quark == 0)
+		return NULL;
+
+	language_snippets = g_hash_table_lookup (snippets_db->priv->language_snippets_map,
+	                                         GUINT_TO_POINTER (language_quark));
+	if (language_snippets == NULL || language_snippets->len == 0)
+		return NULL;
+	sort_language_index (snippets_db);
+
+	if (trigger_prefix == NULL || trigger_prefix[0] == 0)
+	{
+		*n_snippets = language_snippets->len;
+		return (AnjutaSnippet **)language_snippets->pdata;
+	}
+
+	/* The matching trigger-keys are consecutive, starting at the lower bound */
+	start = get_trigger_lower_bound (language_snippets, trigger_prefix);
+	for (end = start; end < language_snippets->len; end ++)
+	{
+		if (!g_str_has_prefix (snippet_get_trigger_key (g_ptr_array_index (language_snippets, end)),
+		                       trigger_prefix))
+			break;
 	}
 
-	/* Calculate the snippet-key */
-	snippet_key = get_snippet_key_from_trigger_and_language (trigger_key, language);
-	if (snippet_key == NULL)
+	*n_snippets = end - start;
+	if (*n_snippets == 0)
 		return NULL;
-	
-	/* Look up the the snippet in the hashtable */
-	snippet = g_hash_table_lookup (snippets_db->priv->snippet_keys_map, snippet_key);
 
-	g_free (snippet_key);
-	return snippet;
+	return (AnjutaSnippet **)&language_snippets->pdata[start];
+}
+
+/**
+ * snippets_db_get_snippets_containing_words:
+ * @snippets_db: A #SnippetsDB object.
+ * @language: The language the snippets should support, or NULL for any language.
+ * @words: A #GList of lower-cased words.
+ *
+ * Finds the snippets which might contain every word of @words in their lower-cased
+ * trigger-key, name or keywords, using the trigram index: a snippet is returned only
+ * if it has all the trigrams of all the words. The result is a superset of the
+ * snippets containing the words, so the caller still has to check them.
+ *
+ * Returns: A new #GPtrArray of #AnjutaSnippet objects owned by the @snippets_db, which
+ *          should be free'd with g_ptr_array_free, or NULL if the words are too short to
+ *          have trigrams and every snippet is a candidate.
+ */
+GPtrArray*
+snippets_db_get_snippets_containing_words (SnippetsDB *snippets_db,
+                                           const gchar *language,
+                                           GList *words)
+{
+	SnippetsDBPrivate *priv = NULL;
+	GHashTable *trigrams = NULL;
+	GHashTableIter hash_iter;
+	gpointer trigram = NULL;
+	GPtrArray *trigram_snippets = NULL, *postings = NULL, *result = NULL;
+	GList *iter = NULL;
+	AnjutaSnippet *cur_snippet = NULL;
+	guint i = 0, n_kept = 0;
+
+	/* Assertions */
+	g_return_val_if_fail (ANJUTA_IS_SNIPPETS_DB (snippets_db), NULL);
+	priv = ANJUTA_SNIPPETS_DB_GET_PRIVATE (snippets_db);
+
+	/* Get the distinct trigrams of all the words */
+	trigrams = g_hash_table_new (g_direct_hash, g_direct_equal);
+	for (iter = g_list_first (words); iter != NULL; iter = g_list_next (iter))
+		add_trigrams_of_string (trigrams, (const gchar *)iter->data);
+
+	if (g_hash_table_size (trigrams) == 0)
+	{
+		g_hash_table_destroy (trigrams);
+		return NULL;
+	}
+
+	sort_trigram_index (snippets_db);
+	result = g_ptr_array_new ();
+
+	/* Get the snippets list of each trigram. If a trigram doesn't appear in any
+	   snippet, nothing can match. */
+	postings = g_ptr_array_sized_new (g_hash_table_size (trigrams));
+	g_hash_table_iter_init (&hash_iter, trigrams);
+	while (g_hash_table_iter_next (&hash_iter, &trigram, NULL))
+	{
+		trigram_snippets = g_hash_table_lookup (priv->trigram_snippets_map, trigram);
+		if (trigram_snippets == NULL || trigram_snippets->len == 0)
+		{
+			g_ptr_array_free (postings, TRUE);
+			g_hash_table_destroy (trigrams);
+			return result;
+		}
+
+		g_ptr_array_add (postings, trigram_snippets);
+	}
+	g_hash_table_destroy (trigrams);
+
+	/* Intersect the lists, starting with the shortest so the result stays small */
+	g_ptr_array_sort (postings, compare_ptr_arrays_by_length);
+	trigram_snippets = g_ptr_array_index (postings, 0);
+	for (i = 0; i < trigram_snippets->len; i ++)
+		g_ptr_array_add (result, g_ptr_array_index (trigram_snippets, i));
+
+	for (i = 1; i < postings->len && result->len > 0; i ++)
+		intersect_sorted_snippets (result, g_ptr_array_index (postings, i));
+	g_ptr_array_free (postings, TRUE);
+
+	if (language == NULL)
+		return result;
+
+	/* Keep only the snippets supporting the language */
+	for (i = 0; i < result->len; i ++)
+	{
+		cur_snippet = g_ptr_array_index (result, i);
+		if (lookup_snippet_in_hash_table (snippets_db,
+		                                  snippet_get_trigger_key (cur_snippet),
+		                                  language) == cur_snippet)
+			result->pdata[n_kept ++] = cur_snippet;
+	}
+	g_ptr_array_set_size (result, n_kept);
+
+	return result;
 }
 
 /**
@@ -929,8 +1731,9 @@ snippets_db_remove_snippet (SnippetsDB* snippets_db,
 {
 	AnjutaSnippet *deleted_snippet = NULL;
 	AnjutaSnippetsGroup *deleted_snippet_group = NULL;
-	gchar *snippet_key = NULL;
+	SnippetKey snippet_key;
 	GtkTreePath *path = NULL;
+	GtkTreeIter tree_iter;
 	SnippetsDBPrivate *priv = NULL;
 	
 	/* Assertions */
@@ -938,12 +1741,10 @@ snippets_db_remove_snippet (SnippetsDB* snippets_db,
 	priv = ANJUTA_SNIPPETS_DB_GET_PRIVATE (snippets_db);
 
 	/* Get the snippet to be deleted */
-	snippet_key = get_snippet_key_from_trigger_and_language (trigger_key, language);
-	if (snippet_key == NULL)
+	if (!snippet_key_init (&snippet_key, trigger_key, language, FALSE))
 		return FALSE;
 
-	deleted_snippet = g_hash_table_lookup (priv->snippet_keys_map, snippet_key);
-	g_free (snippet_key);
+	deleted_snippet = g_hash_table_lookup (priv->snippet_keys_map, &snippet_key);
 	if (!ANJUTA_IS_SNIPPET (deleted_snippet))
 		return FALSE;
 
@@ -954,13 +1755,17 @@ snippets_db_remove_snippet (SnippetsDB* snippets_db,
 	else
 	{
 		/* We remove just the current language support from the database */
-		g_hash_table_remove (priv->snippet_keys_map, snippet_key);
+		g_hash_table_remove (priv->snippet_keys_map, &snippet_key);
+		remove_snippet_from_language_index (snippets_db, deleted_snippet, snippet_key.language);
 	}
 
-	/* Emit the signal that the snippet was deleted */
-	path = get_tree_path_for_snippet (snippets_db, deleted_snippet);
-	gtk_tree_model_row_deleted (GTK_TREE_MODEL (snippets_db), path);
-	gtk_tree_path_free (path);
+	/* Get the path before the snippet is removed from the snippets group. While in
+	   a batch, the rows are hidden so we don't need it. */
+	if (priv->batch_depth == 0)
+	{
+		path = get_tree_path_for_snippet (snippets_db, deleted_snippet);
+		g_return_val_if_fail (path != NULL, FALSE);
+	}
 	
 	/* Remove it from the snippets group */
 	deleted_snippet_group = ANJUTA_SNIPPETS_GROUP (deleted_snippet->parent_snippets_group);
@@ -969,6 +1774,23 @@ snippets_db_remove_snippet (SnippetsDB* snippets_db,
 	                               trigger_key, 
 	                               language,
 	                               remove_all_languages_support);
+	invalidate_snapshot (snippets_db);
+
+	if (path == NULL)
+		return TRUE;
+
+	/* Emit the signal that the snippet was deleted (or just changed, if only the
+	   language support was removed) */
+	if (remove_all_languages_support)
+	{
+		gtk_tree_model_row_deleted (GTK_TREE_MODEL (snippets_db), path);
+	}
+	else
+	{
+		snippets_db_get_iter (GTK_TREE_MODEL (snippets_db), &tree_iter, path);
+		gtk_tree_model_row_changed (GTK_TREE_MODEL (snippets_db), path, &tree_iter);
+	}
+	gtk_tree_path_free (path);
 
 	return TRUE;
 }
@@ -992,7 +1814,7 @@ snippets_db_add_snippets_group (SnippetsDB* snippets_db,
                                 gboolean overwrite_group)
 {
 	AnjutaSnippet *cur_snippet = NULL;
-	GList *iter = NULL, *snippets_list = NULL;
+	guint i = 0, position = 0;
 	SnippetsDBPrivate *priv = NULL;
 	GtkTreeIter tree_iter;
 	GtkTreePath *path;
@@ -1012,13 +1834,12 @@ snippets_db_add_snippets_group (SnippetsDB* snippets_db,
 		return FALSE;
 
 	/* Check for conflicts */
-	snippets_list = snippets_group_get_snippets_list (snippets_group);
-	for (iter = g_list_first (snippets_list); iter != NULL; iter = g_list_next (iter))
+	while (i < snippets_group_get_n_snippets (snippets_group))
 	{
-		cur_snippet = ANJUTA_SNIPPET (iter->data);
-		if (!ANJUTA_IS_SNIPPET (cur_snippet))
-			continue;
+		cur_snippet = snippets_group_get_nth_snippet (snippets_group, i);
 
+		/* If it's conflicting, it's removed from the group and the next snippet
+		   takes its index */
 		if (snippets_db_has_snippet (snippets_db, cur_snippet))
 		{
 			snippets_group_remove_snippet (snippets_group,
@@ -1029,15 +1850,33 @@ snippets_db_add_snippets_group (SnippetsDB* snippets_db,
 		else
 		{
 			add_snippet_to_hash_table (snippets_db, cur_snippet);
+			i ++;
 		}
 	}
 
-	/* Add the snippets_group to the database keeping sorted the list by the
-	   group name. */
-	priv->snippets_groups = g_list_insert_sorted (priv->snippets_groups,
-	                                              snippets_group,
-	                                              compare_snippets_groups_by_name);
+	/* Add the snippets_group to the database keeping sorted the array by the
+	   group name. While in a batch, it's appended and the array is sorted when
+	   the batch ends. */
+	if (priv->batch_depth > 0)
+		position = priv->snippets_groups->len;
+	else
+		position = get_insert_position_for_snippets_group (snippets_db, snippets_group);
+	g_ptr_array_add (priv->snippets_groups, snippets_group);
+	if (position < priv->snippets_groups->len - 1)
+	{
+		g_memmove (&priv->snippets_groups->pdata[position + 1],
+		           &priv->snippets_groups->pdata[position],
+		           (priv->snippets_groups->len - position - 1) * sizeof (gpointer));
+		priv->snippets_groups->pdata[position] = snippets_group;
+	}
 	g_object_ref (snippets_group);
+	invalidate_snippets_groups_positions (snippets_db, position);
+	g_hash_table_insert (priv->snippets_groups_map, g_strdup (group_name), snippets_group);
+	invalidate_snapshot (snippets_db);
+
+	/* While in a batch, the rows are inserted when it ends */
+	if (priv->batch_depth > 0)
+		return TRUE;
 
 	/* Emit the signal that the database was changed */
 	path = get_tree_path_for_snippets_group (snippets_db, snippets_group);
@@ -1061,7 +1900,7 @@ gboolean
 snippets_db_remove_snippets_group (SnippetsDB* snippets_db,
                                    const gchar* group_name)
 {
-	GList *iter = NULL;
+	guint position = 0;
 	AnjutaSnippetsGroup *snippets_group = NULL;
 	GtkTreePath *path = NULL;
 	SnippetsDBPrivate *priv = NULL;
@@ -1071,32 +1910,33 @@ snippets_db_remove_snippets_group (SnippetsDB* snippets_db,
 	g_return_val_if_fail (group_name != NULL, FALSE);
 	priv = ANJUTA_SNIPPETS_DB_GET_PRIVATE (snippets_db);
 	
-	for (iter = g_list_first (priv->snippets_groups); iter != NULL; iter = g_list_next (iter))
-	{
-		snippets_group = ANJUTA_SNIPPETS_GROUP (iter->data);
-		g_return_val_if_fail (ANJUTA_IS_SNIPPETS_GROUP (snippets_group), FALSE);
-	
-		if (!g_strcmp0 (group_name, snippets_group_get_name (snippets_group)))
-		{
-			/* Remove the snippets in the group from the hash-table */
-			remove_snippets_group_from_hash_table (snippets_db, snippets_group);
+	snippets_group = snippets_db_get_snippets_group (snippets_db, group_name);
+	if (!ANJUTA_IS_SNIPPETS_GROUP (snippets_group))
+		return FALSE;
+	position = get_snippets_group_position (snippets_db, snippets_group);
+	g_return_val_if_fail (g_ptr_array_index (priv->snippets_groups, position) == snippets_group,
+	                      FALSE);
 
-			/* Emit the signal that it was deleted */
-			path = get_tree_path_for_snippets_group (snippets_db, snippets_group);
-			gtk_tree_model_row_deleted (GTK_TREE_MODEL (snippets_db), path);
-			gtk_tree_path_free (path);
+	/* Remove the snippets in the group from the hash-table */
+	remove_snippets_group_from_hash_table (snippets_db, snippets_group);
+	g_hash_table_remove (priv->snippets_groups_map, group_name);
 
-			/* Destroy the snippets-group object */
-			g_object_unref (snippets_group);
+	/* Delete it from the array and update the positions of the other groups */
+	path = get_tree_path_for_snippets_group (snippets_db, snippets_group);
+	g_ptr_array_remove_index (priv->snippets_groups, position);
+	snippets_group->position = -1;
+	invalidate_snippets_groups_positions (snippets_db, position);
+	invalidate_snapshot (snippets_db);
 
-			/* Delete the list node */
-			iter->data = NULL;
-			priv->snippets_groups = g_list_delete_link (priv->snippets_groups, iter);
-			return TRUE;
-		}
-	}
+	/* Emit the signal that it was deleted. While in a batch the rows are hidden. */
+	if (priv->batch_depth == 0)
+		gtk_tree_model_row_deleted (GTK_TREE_MODEL (snippets_db), path);
+	gtk_tree_path_free (path);
 
-	return FALSE;
+	/* Destroy the snippets-group object */
+	g_object_unref (snippets_group);
+
+	return TRUE;
 }
 
 /**
@@ -1110,25 +1950,13 @@ AnjutaSnippetsGroup*
 snippets_db_get_snippets_group (SnippetsDB* snippets_db,
                                 const gchar* group_name)
 {
-	AnjutaSnippetsGroup *snippets_group = NULL;
-	SnippetsDBPrivate *priv = NULL;
-	GList *iter = NULL;
-	
 	/* Assertions */
 	g_return_val_if_fail (ANJUTA_IS_SNIPPETS_DB (snippets_db), NULL);
+	if (group_name == NULL)
+		return NULL;
 
 	/* Look up the AnjutaSnippetsGroup object with the name being group_name */
-	priv = snippets_db->priv;
-	for (iter = g_list_first (priv->snippets_groups); iter != NULL; iter = g_list_next (iter))
-	{
-		snippets_group = (AnjutaSnippetsGroup *)iter->data;
-		if (!g_strcmp0 (snippets_group_get_name (snippets_group), group_name))
-		{
-			return snippets_group;
-		}
-	}
-	
-	return NULL;
+	return g_hash_table_lookup (snippets_db->priv->snippets_groups_map, group_name);
 }
 
 
@@ -1192,7 +2020,7 @@ snippets_db_get_global_variable_text (SnippetsDB* snippets_db,
 	global_vars_store = snippets_db->priv->global_variables;
 
 	/* Search for the variable */
-	iter = get_iter_at_global_variable_name (global_vars_store, variable_name);
+	iter = get_iter_at_global_variable_name (snippets_db, variable_name);
 	if (iter)
 	{
 		/* Check if it's internal or not */
@@ -1215,8 +2043,34 @@ snippets_db_get_global_variable_text (SnippetsDB* snippets_db,
 		}
 	}
 
-	return NULL;
+	return NULL;
+
+}
+
+/* Launches the command of a global variable and returns its output without the
+   trailing newline, or NULL if it failed. It can be called from any thread. */
+static gchar *
+get_global_variable_command_output (const gchar *command_line)
+{
+	gchar *command_output = NULL, *command_error = NULL;
+	gsize command_output_size = 0;
+	gboolean command_success = FALSE;
+
+	command_success = g_spawn_command_line_sync (command_line,
+	                                             &command_output,
+	                                             &command_error,
+	                                             NULL,
+	                                             NULL);
+	g_free (command_error);
+	if (!command_success)
+		return NULL;
+
+	/* If the last character is a newline we eliminate it */
+	command_output_size = strlen (command_output);
+	if (command_output_size > 0 && command_output[command_output_size - 1] == '\n')
+		command_output[command_output_size - 1] = 0;
 
+	return command_output;
 }
 
 /**
@@ -1235,8 +2089,8 @@ snippets_db_get_global_variable (SnippetsDB* snippets_db,
 {
 	GtkTreeIter *iter = NULL;
 	GtkListStore *global_vars_store = NULL;
-	gboolean is_command = FALSE, is_internal = FALSE, command_success = FALSE;
-	gchar *value = NULL, *command_line = NULL, *command_output = NULL, *command_error = NULL;
+	gboolean is_command = FALSE, is_internal = FALSE;
+	gchar *value = NULL, *command_line = NULL, *command_output = NULL;
 	
 	/* Assertions */
 	g_return_val_if_fail (ANJUTA_IS_SNIPPETS_DB (snippets_db), NULL);
@@ -1245,7 +2099,7 @@ snippets_db_get_global_variable (SnippetsDB* snippets_db,
 	global_vars_store = snippets_db->priv->global_variables;
 
 	/* Search for the variable */
-	iter = get_iter_at_global_variable_name (global_vars_store, variable_name);
+	iter = get_iter_at_global_variable_name (snippets_db, variable_name);
 	if (iter)
 	{
 		/* Check if it's a command/internal or not */
@@ -1268,24 +2122,10 @@ snippets_db_get_global_variable (SnippetsDB* snippets_db,
 			gtk_tree_model_get (GTK_TREE_MODEL (global_vars_store), iter,
 			                    GLOBAL_VARS_MODEL_COL_VALUE, &command_line, 
 			                    -1);
-			command_success = g_spawn_command_line_sync (command_line,
-			                                             &command_output,
-			                                             &command_error,
-			                                             NULL,
-			                                             NULL);
+			command_output = get_global_variable_command_output (command_line);
 			g_free (command_line);
-			g_free (command_error);
-			if (command_success)
-			{
-				/* If the last character is a newline we eliminate it */
-				gint command_output_size = 0;
-				while (command_output[command_output_size] != 0)
-					command_output_size ++;
-				if (command_output[command_output_size - 1] == '\n')
-					command_output[command_output_size - 1] = 0;
-					
-				return command_output;
-			}
+
+			return command_output;
 		}
 		/* If it's static just return the value stored */
 		else
@@ -1301,6 +2141,155 @@ snippets_db_get_global_variable (SnippetsDB* snippets_db,
 	return NULL;
 }
 
+/* The commands launched by a #snippets_db_get_global_variables call, which waits
+   until n_pending drops to 0 */
+typedef struct _GlobalVariableCommandsBatch
+{
+	GMutex *mutex;
+	GCond *cond;
+	guint n_pending;
+} GlobalVariableCommandsBatch;
+
+typedef struct _GlobalVariableCommand
+{
+	gchar *command_line;
+	gchar *output;
+	GlobalVariableCommandsBatch *batch;
+} GlobalVariableCommand;
+
+static void
+run_global_variable_command (gpointer data,
+                             gpointer user_data)
+{
+	GlobalVariableCommand *command = (GlobalVariableCommand *)data;
+	GlobalVariableCommandsBatch *batch = command->batch;
+
+	command->output = get_global_variable_command_output (command->command_line);
+
+	if (batch == NULL)
+		return;
+
+	g_mutex_lock (batch->mutex);
+	batch->n_pending --;
+	if (batch->n_pending == 0)
+		g_cond_signal (batch->cond);
+	g_mutex_unlock (batch->mutex);
+}
+
+/**
+ * snippets_db_get_global_variables:
+ * @snippets_db: A #SnippetsDB object.
+ * @variable_names: The names of the global variables.
+ * @n_variables: The number of names.
+ *
+ * Gets the values of several global variables, like #snippets_db_get_global_variable.
+ * The commands of the command variables are launched at the same time, so getting
+ * the values takes as long as the slowest command.
+ *
+ * Returns: A new array with the value of each variable, or NULL for the ones which
+ *          weren't found. The values and the array should be free'd.
+ */
+gchar**
+snippets_db_get_global_variables (SnippetsDB *snippets_db,
+                                  const gchar **variable_names,
+                                  guint n_variables)
+{
+	GtkTreeIter *iter = NULL;
+	GtkTreeModel *global_vars_model = NULL;
+	gboolean is_command = FALSE, is_internal = FALSE;
+	GlobalVariableCommand *commands = NULL;
+	GlobalVariableCommandsBatch batch;
+	gchar **values = NULL;
+	guint i = 0, n_commands = 0;
+
+	/* Assertions */
+	g_return_val_if_fail (ANJUTA_IS_SNIPPETS_DB (snippets_db), NULL);
+	g_return_val_if_fail (snippets_db->priv != NULL, NULL);
+	g_return_val_if_fail (GTK_IS_LIST_STORE (snippets_db->priv->global_variables), NULL);
+	global_vars_model = GTK_TREE_MODEL (snippets_db->priv->global_variables);
+
+	values   = g_new0 (gchar *, n_variables);
+	commands = g_new0 (GlobalVariableCommand, n_variables);
+
+	/* Get the static and the internal values and the command lines */
+	for (i = 0; i < n_variables; i ++)
+	{
+		iter = get_iter_at_global_variable_name (snippets_db, variable_names[i]);
+		if (iter == NULL)
+			continue;
+
+		gtk_tree_model_get (global_vars_model, iter,
+		                    GLOBAL_VARS_MODEL_COL_IS_COMMAND, &is_command,
+		                    GLOBAL_VARS_MODEL_COL_IS_INTERNAL, &is_internal,
+		                    -1);
+
+		if (is_internal)
+			values[i] = get_internal_global_variable_value (snippets_db->anjuta_shell,
+			                                                variable_names[i]);
+		else if (is_command)
+		{
+			gtk_tree_model_get (global_vars_model, iter,
+			                    GLOBAL_VARS_MODEL_COL_VALUE, &commands[i].command_line,
+			                    -1);
+			n_commands ++;
+		}
+		else
+			gtk_tree_model_get (global_vars_model, iter,
+			                    GLOBAL_VARS_MODEL_COL_VALUE, &values[i],
+			                    -1);
+	}
+
+	/* Launch the commands. A single one is launched right away. */
+	if (n_commands == 1)
+	{
+		for (i = 0; i < n_variables; i ++)
+			if (commands[i].command_line != NULL)
+				run_global_variable_command (&commands[i], NULL);
+	}
+	else
+	if (n_commands > 1)
+	{
+		if (snippets_db->priv->commands_pool == NULL)
+			snippets_db->priv->commands_pool = g_thread_pool_new (run_global_variable_command,
+			                                                      NULL,
+			                                                      GLOBAL_VAR_COMMANDS_MAX_THREADS,
+			                                                      FALSE,
+			                                                      NULL);
+
+		batch.mutex     = g_mutex_new ();
+		batch.cond      = g_cond_new ();
+		batch.n_pending = n_commands;
+
+		for (i = 0; i < n_variables; i ++)
+		{
+			if (commands[i].command_line == NULL)
+				continue;
+
+			commands[i].batch = &batch;
+			g_thread_pool_push (snippets_db->priv->commands_pool, &commands[i], NULL);
+		}
+
+		/* Wait for all of them to finish */
+		g_mutex_lock (batch.mutex);
+		while (batch.n_pending > 0)
+			g_cond_wait (batch.cond, batch.mutex);
+		g_mutex_unlock (batch.mutex);
+
+		g_mutex_free (batch.mutex);
+		g_cond_free (batch.cond);
+	}
+
+	for (i = 0; i < n_variables; i ++)
+	{
+		if (commands[i].command_line != NULL)
+			values[i] = commands[i].output;
+		g_free (commands[i].command_line);
+	}
+	g_free (commands);
+
+	return values;
+}
+
 /**
  * snippets_db_has_global_variable:
  * @snippets_db: A #SnippetsDB object.
@@ -1314,23 +2303,12 @@ gboolean
 snippets_db_has_global_variable (SnippetsDB* snippets_db,
                                  const gchar* variable_name)
 {
-	GtkListStore *global_vars_store = NULL;
-	GtkTreeIter *iter = NULL;
-	gboolean found = FALSE;
-	
 	/* Assertions */
 	g_return_val_if_fail (ANJUTA_IS_SNIPPETS_DB (snippets_db), FALSE);
 	g_return_val_if_fail (snippets_db->priv != NULL, FALSE);
-	g_return_val_if_fail (GTK_IS_LIST_STORE (snippets_db->priv->global_variables), FALSE);
-	global_vars_store = snippets_db->priv->global_variables;
 	
-	/* Locate the variable in the GtkListStore */
-	iter = get_iter_at_global_variable_name (global_vars_store, variable_name);
-	found = (iter != NULL);
-	if (iter)
-		gtk_tree_iter_free (iter);
-
-	return found;
+	/* Locate the variable in the index */
+	return (get_iter_at_global_variable_name (snippets_db, variable_name) != NULL);
 }
 
 /**
@@ -1363,7 +2341,7 @@ snippets_db_add_global_variable (SnippetsDB* snippets_db,
 	global_vars_store = snippets_db->priv->global_variables;
 
 	/* Check to see if there is a global variable with the same name in the database */
-	iter = get_iter_at_global_variable_name (global_vars_store, variable_name);
+	iter = get_iter_at_global_variable_name (snippets_db, variable_name);
 	if (iter)
 	{
 		gtk_tree_model_get (GTK_TREE_MODEL (global_vars_store), iter,
@@ -1379,12 +2357,10 @@ snippets_db_add_global_variable (SnippetsDB* snippets_db,
 			                    GLOBAL_VARS_MODEL_COL_IS_COMMAND, variable_is_command,
 			                    GLOBAL_VARS_MODEL_COL_IS_INTERNAL, FALSE,
 			                    -1);
-			gtk_tree_iter_free (iter);
 			return TRUE;	
 		}
 		else
 		{
-			gtk_tree_iter_free (iter);
 			return FALSE;
 		}
 	}
@@ -1398,6 +2374,7 @@ snippets_db_add_global_variable (SnippetsDB* snippets_db,
 		                    GLOBAL_VARS_MODEL_COL_IS_COMMAND, variable_is_command,
 		                    GLOBAL_VARS_MODEL_COL_IS_INTERNAL, FALSE,
 		                    -1);
+		add_global_variable_to_hash_table (snippets_db, variable_name, &iter_to_add);
 	}
 	return TRUE;
 }
@@ -1418,7 +2395,7 @@ snippets_db_set_global_variable_name (SnippetsDB* snippets_db,
                                       const gchar* variable_new_name)
 {
 	GtkListStore *global_vars_store = NULL;
-	GtkTreeIter *iter = NULL;
+	GtkTreeIter *iter = NULL, renamed_iter;
 	gboolean is_internal = FALSE;
 	
 	/* Assertions */
@@ -1428,15 +2405,11 @@ snippets_db_set_global_variable_name (SnippetsDB* snippets_db,
 	global_vars_store = snippets_db->priv->global_variables;
 
 	/* Test if the variable_new_name is already in the database */
-	iter = get_iter_at_global_variable_name (global_vars_store, variable_new_name);
-	if (iter)
-	{
-		gtk_tree_iter_free (iter);
+	if (get_iter_at_global_variable_name (snippets_db, variable_new_name))
 		return FALSE;
-	}
 
 	/* Get a GtkTreeIter pointing at the global variable to be updated */
-	iter = get_iter_at_global_variable_name (global_vars_store, variable_old_name);
+	iter = get_iter_at_global_variable_name (snippets_db, variable_old_name);
 	if (iter)
 	{
 		gtk_tree_model_get (GTK_TREE_MODEL (global_vars_store), iter,
@@ -1448,12 +2421,15 @@ snippets_db_set_global_variable_name (SnippetsDB* snippets_db,
 			gtk_list_store_set (global_vars_store, iter,
 			                    GLOBAL_VARS_MODEL_COL_NAME, variable_new_name,
 			                    -1);
-			gtk_tree_iter_free (iter);
+
+			/* Update the index. The stored iter is freed on removal, so we copy it. */
+			renamed_iter = *iter;
+			g_hash_table_remove (snippets_db->priv->global_variables_map, variable_old_name);
+			add_global_variable_to_hash_table (snippets_db, variable_new_name, &renamed_iter);
 			return TRUE;
 		}
 		else
 		{
-			gtk_tree_iter_free (iter);
 			return FALSE;
 		}
 	}
@@ -1477,7 +2453,6 @@ snippets_db_set_global_variable_value (SnippetsDB* snippets_db,
 	GtkListStore *global_vars_store = NULL;
 	GtkTreeIter *iter = NULL;
 	gboolean is_internal = FALSE;
-	gchar *stored_value = NULL;
 	
 	/* Assertions */
 	g_return_val_if_fail (ANJUTA_IS_SNIPPETS_DB (snippets_db), FALSE);
@@ -1486,32 +2461,23 @@ snippets_db_set_global_variable_value (SnippetsDB* snippets_db,
 	global_vars_store = snippets_db->priv->global_variables;
 	
 	/* Get a GtkTreeIter pointing at the global variable to be updated */
-	iter = get_iter_at_global_variable_name (global_vars_store, variable_name);
+	iter = get_iter_at_global_variable_name (snippets_db, variable_name);
 	if (iter)
 	{
 		gtk_tree_model_get (GTK_TREE_MODEL (global_vars_store), iter,
 		                    GLOBAL_VARS_MODEL_COL_IS_INTERNAL, &is_internal,
 		                    -1);
-		gtk_tree_model_get (GTK_TREE_MODEL (global_vars_store), iter,
-		                    GLOBAL_VARS_MODEL_COL_VALUE, &stored_value,
-		                    -1);
 		                    
 		if (!is_internal)
 		{
 			gtk_list_store_set (global_vars_store, iter,
 			                    GLOBAL_VARS_MODEL_COL_VALUE, variable_new_value,
 			                    -1);
-			                    
-			g_free (stored_value);
-			gtk_tree_iter_free (iter);
 
 			return TRUE;
 		}
 		else
 		{
-			g_free (stored_value);
-			gtk_tree_iter_free (iter);
-			
 			return FALSE;
 		}
 	}
@@ -1543,7 +2509,7 @@ snippets_db_set_global_variable_type (SnippetsDB *snippets_db,
 	global_vars_store = snippets_db->priv->global_variables;
 	
 	/* Get a GtkTreeIter pointing at the global variable to be updated */
-	iter = get_iter_at_global_variable_name (global_vars_store, variable_name);
+	iter = get_iter_at_global_variable_name (snippets_db, variable_name);
 	if (iter)
 	{
 		gtk_tree_model_get (GTK_TREE_MODEL (global_vars_store), iter,
@@ -1555,12 +2521,10 @@ snippets_db_set_global_variable_type (SnippetsDB *snippets_db,
 			gtk_list_store_set (global_vars_store, iter,
 			                    GLOBAL_VARS_MODEL_COL_IS_COMMAND, is_command,
 			                    -1);
-			gtk_tree_iter_free (iter);
 			return TRUE;
 		}
 		else
 		{
-			gtk_tree_iter_free (iter);
 			return FALSE;
 		}
 	}
@@ -1583,7 +2547,7 @@ snippets_db_remove_global_variable (SnippetsDB* snippets_db,
                                     const gchar* variable_name)
 {
 	GtkListStore *global_vars_store = NULL;
-	GtkTreeIter *iter = NULL;
+	GtkTreeIter *iter = NULL, removed_iter;
 	gboolean is_internal = FALSE;
 	
 	/* Assertions */
@@ -1593,7 +2557,7 @@ snippets_db_remove_global_variable (SnippetsDB* snippets_db,
 	global_vars_store = snippets_db->priv->global_variables;
 	
 	/* Get a GtkTreeIter pointing at the global variable to be removed */
-	iter = get_iter_at_global_variable_name (global_vars_store, variable_name);
+	iter = get_iter_at_global_variable_name (snippets_db, variable_name);
 	if (iter)
 	{
 		gtk_tree_model_get (GTK_TREE_MODEL (global_vars_store), iter,
@@ -1602,13 +2566,14 @@ snippets_db_remove_global_variable (SnippetsDB* snippets_db,
 
 		if (!is_internal)
 		{
-			gtk_list_store_remove (global_vars_store, iter);
-			gtk_tree_iter_free (iter);
+			/* gtk_list_store_remove moves the iter to the next row, so we pass a copy */
+			removed_iter = *iter;
+			g_hash_table_remove (snippets_db->priv->global_variables_map, variable_name);
+			gtk_list_store_remove (global_vars_store, &removed_iter);
 			return TRUE;
 		}
 		else
 		{
-			gtk_tree_iter_free (iter);
 			return FALSE;
 		}
 	}
@@ -1638,23 +2603,210 @@ snippets_db_get_global_vars_model (SnippetsDB* snippets_db)
 	return GTK_TREE_MODEL (snippets_db->priv->global_variables);
 }
 
+static SnippetsDBSnapshot *
+build_snapshot (SnippetsDB *snippets_db)
+{
+	SnippetsDBPrivate *priv = snippets_db->priv;
+	SnippetsDBSnapshot *snapshot = NULL;
+	SnippetsDBSnapshotEntry *entry = NULL;
+	AnjutaSnippetsGroup *cur_snippets_group = NULL;
+	AnjutaSnippet *cur_snippet = NULL;
+	const guint *search_lengths = NULL;
+	guint i = 0, j = 0, n_entries = 0;
+
+	snapshot = g_new0 (SnippetsDBSnapshot, 1);
+	snapshot->generation = priv->generation;
+	snapshot->ref_count  = 1;
+
+	/* The entries are found from the positions of the groups */
+	update_snippets_groups_positions (snippets_db);
+
+	/* The entries of a group start where the ones of the previous groups end */
+	snapshot->n_groups       = priv->snippets_groups->len;
+	snapshot->groups_offsets = g_new (guint, snapshot->n_groups + 1);
+	for (i = 0; i < priv->snippets_groups->len; i ++)
+	{
+		snapshot->groups_offsets[i] = n_entries;
+		n_entries += snippets_group_get_n_snippets (g_ptr_array_index (priv->snippets_groups, i));
+	}
+	snapshot->groups_offsets[i] = n_entries;
+
+	snapshot->entries = g_new0 (SnippetsDBSnapshotEntry, n_entries);
+
+	for (i = 0; i < priv->snippets_groups->len; i ++)
+	{
+		cur_snippets_group = g_ptr_array_index (priv->snippets_groups, i);
+
+		for (j = 0; j < snippets_group_get_n_snippets (cur_snippets_group); j ++)
+		{
+			cur_snippet = snippets_group_get_nth_snippet (cur_snippets_group, j);
+			entry = &snapshot->entries[snapshot->n_entries ++];
+
+			/* The search fields are already computed by the snippet */
+			search_lengths = snippet_get_search_lengths (cur_snippet, &entry->n_search_lengths);
+
+			entry->snippet            = g_object_ref (cur_snippet);
+			entry->name               = g_strdup (snippet_get_name (cur_snippet));
+			entry->search_trigger_key = g_strdup (snippet_get_search_trigger_key (cur_snippet));
+			entry->search_name        = g_strdup (snippet_get_search_name (cur_snippet));
+			entry->search_keywords    = g_strdupv ((gchar **)snippet_get_search_keywords (cur_snippet));
+			entry->search_chars_mask  = snippet_get_search_chars_mask (cur_snippet);
+			entry->search_lengths     = g_memdup (search_lengths,
+			                                      entry->n_search_lengths * sizeof (guint));
+		}
+	}
+
+	return snapshot;
+}
+
+/**
+ * snippets_db_get_generation:
+ * @snippets_db: A #SnippetsDB object.
+ *
+ * The generation is incremented every time a snippet or a group is added or removed.
+ * Comparing it with the generation of a #SnippetsDBSnapshot tells if the snapshot is
+ * still up to date.
+ *
+ * Returns: The current generation of the @snippets_db.
+ */
+guint
+snippets_db_get_generation (SnippetsDB *snippets_db)
+{
+	/* Assertions */
+	g_return_val_if_fail (ANJUTA_IS_SNIPPETS_DB (snippets_db), 0);
+
+	return snippets_db->priv->generation;
+}
+
+/**
+ * snippets_db_get_snapshot:
+ * @snippets_db: A #SnippetsDB object.
+ *
+ * Gets an immutable copy of the search data of the current snippets. The snapshot
+ * is built the first time it's requested for a generation and shared afterwards. This
+ * should be called from the main loop, but the returned snapshot can be passed to
+ * other threads.
+ *
+ * Returns: A new reference to the #SnippetsDBSnapshot. Release it with 
+ *          #snippets_db_snapshot_unref.
+ */
+SnippetsDBSnapshot*
+snippets_db_get_snapshot (SnippetsDB *snippets_db)
+{
+	SnippetsDBPrivate *priv = NULL;
+
+	/* Assertions */
+	g_return_val_if_fail (ANJUTA_IS_SNIPPETS_DB (snippets_db), NULL);
+	priv = ANJUTA_SNIPPETS_DB_GET_PRIVATE (snippets_db);
+
+	if (priv->snapshot == NULL)
+		priv->snapshot = build_snapshot (snippets_db);
+
+	return snippets_db_snapshot_ref (priv->snapshot);
+}
+
+/**
+ * snippets_db_snapshot_ref:
+ * @snapshot: A #SnippetsDBSnapshot.
+ *
+ * Returns: The @snapshot, with it's reference count increased by one.
+ */
+SnippetsDBSnapshot*
+snippets_db_snapshot_ref (SnippetsDBSnapshot *snapshot)
+{
+	/* Assertions */
+	g_return_val_if_fail (snapshot != NULL, NULL);
+
+	g_atomic_int_inc (&snapshot->ref_count);
+	return snapshot;
+}
+
+/**
+ * snippets_db_snapshot_unref:
+ * @snapshot: A #SnippetsDBSnapshot.
+ *
+ * Decreases the reference count of the @snapshot and frees it when it drops to 0.
+ */
+void
+snippets_db_snapshot_unref (SnippetsDBSnapshot *snapshot)
+{
+	guint i = 0;
+
+	/* Assertions */
+	g_return_if_fail (snapshot != NULL);
+
+	if (!g_atomic_int_dec_and_test (&snapshot->ref_count))
+		return;
+
+	for (i = 0; i < snapshot->n_entries; i ++)
+	{
+		g_object_unref (snapshot->entries[i].snippet);
+		g_free (snapshot->entries[i].name);
+		g_free (snapshot->entries[i].search_trigger_key);
+		g_free (snapshot->entries[i].search_name);
+		g_strfreev (snapshot->entries[i].search_keywords);
+		g_free (snapshot->entries[i].search_lengths);
+	}
+	g_free (snapshot->entries);
+	g_free (snapshot->groups_offsets);
+	g_free (snapshot);
+}
+
+/**
+ * snippets_db_snapshot_get_entry:
+ * @snapshot: A #SnippetsDBSnapshot of the current generation.
+ * @snippet: An #AnjutaSnippet stored in the #SnippetsDB.
+ *
+ * Finds the entry of the @snippet from the positions of the snippet and of its
+ * group, so it's O(1). As the positions change with the #SnippetsDB, this should
+ * be called from the main loop, while the @snapshot is still up to date.
+ *
+ * Returns: The entry of the snippet, owned by the @snapshot, or NULL if not found.
+ */
+const SnippetsDBSnapshotEntry*
+snippets_db_snapshot_get_entry (SnippetsDBSnapshot *snapshot,
+                                AnjutaSnippet *snippet)
+{
+	AnjutaSnippetsGroup *snippets_group = NULL;
+	gint snippet_position = 0;
+	guint index = 0;
+
+	/* Assertions */
+	g_return_val_if_fail (snapshot != NULL, NULL);
+	g_return_val_if_fail (ANJUTA_IS_SNIPPET (snippet), NULL);
+
+	snippet_position = get_snippet_position (snippet);
+	if (snippet_position < 0)
+		return NULL;
+
+	/* The positions of the groups were brought up to date when the snapshot was built */
+	snippets_group = ANJUTA_SNIPPETS_GROUP (snippet->parent_snippets_group);
+	if (snippets_group->position < 0 || snippets_group->position >= (gint)snapshot->n_groups)
+		return NULL;
+
+	index = snapshot->groups_offsets[snippets_group->position] + snippet_position;
+	if (index >= snapshot->groups_offsets[snippets_group->position + 1] ||
+	    snapshot->entries[index].snippet != snippet)
+		return NULL;
+
+	return &snapshot->entries[index];
+}
+
 /* GtkTreeModel methods definition */
 
+/* The iters store the #AnjutaSnippetsGroup or #AnjutaSnippet object in user_data and,
+   for a snippet, the parent #AnjutaSnippetsGroup in user_data2. The index of a row is
+   read from the position cached in the object, so the iters stay valid while other
+   rows are inserted or deleted. */
+
 static GObject *
 iter_get_data (GtkTreeIter *iter)
 {
-	GList *cur_node = NULL;
-
 	g_return_val_if_fail (iter != NULL, NULL);
-	if (iter->user_data == NULL)
-		return NULL;
-	cur_node = (GList *)iter->user_data;
-	if (cur_node == NULL)
-		return NULL;
-	if (!G_IS_OBJECT (cur_node->data))
+	if (!G_IS_OBJECT (iter->user_data))
 		return NULL;
 		
-	return G_OBJECT (cur_node->data);
+	return G_OBJECT (iter->user_data);
 }
 
 static gboolean
@@ -1666,46 +2818,46 @@ iter_is_snippets_group_node (GtkTreeIter *iter)
 }
 
 static gboolean
-iter_is_snippet_node (GtkTreeIter *iter)
+iter_set_snippets_group_node (GtkTreeIter *iter,
+                              SnippetsDB *snippets_db,
+                              gint n)
 {
-	GObject *data = iter_get_data (iter);
-
-	return ANJUTA_IS_SNIPPET (data);
-}
+	GPtrArray *snippets_groups = NULL;
 
-static gboolean
-iter_get_first_snippets_db_node (GtkTreeIter *iter,
-                                 SnippetsDB *snippets_db)
-{
-	SnippetsDBPrivate *priv = NULL;
-	
 	g_return_val_if_fail (ANJUTA_IS_SNIPPETS_DB (snippets_db), FALSE);
-	priv = ANJUTA_SNIPPETS_DB_GET_PRIVATE (snippets_db);
+	snippets_groups = snippets_db->priv->snippets_groups;
 
-	iter->user_data  = g_list_first (priv->snippets_groups);
+	iter->user_data  = NULL;
 	iter->user_data2 = NULL;
 	iter->user_data3 = NULL;
 	iter->stamp      = snippets_db->stamp;
 
-	return iter->user_data != NULL;
+	if (n < 0 || (guint)n >= get_n_visible_snippets_groups (snippets_db))
+		return FALSE;
+
+	iter->user_data = g_ptr_array_index (snippets_groups, n);
+	return TRUE;
 }
 
 static gboolean
-iter_nth (GtkTreeIter *iter, gint n)
+iter_set_snippet_node (GtkTreeIter *iter,
+                       SnippetsDB *snippets_db,
+                       AnjutaSnippetsGroup *snippets_group,
+                       gint n)
 {
-	g_return_val_if_fail (iter != NULL, FALSE);
-	
-	iter->user_data = g_list_nth ((GList *)iter->user_data, n);
+	g_return_val_if_fail (ANJUTA_IS_SNIPPETS_DB (snippets_db), FALSE);
+	g_return_val_if_fail (ANJUTA_IS_SNIPPETS_GROUP (snippets_group), FALSE);
 
-	return (iter->user_data != NULL);
-}
+	iter->user_data  = NULL;
+	iter->user_data2 = snippets_group;
+	iter->user_data3 = NULL;
+	iter->stamp      = snippets_db->stamp;
 
-static GList *
-iter_get_list_node (GtkTreeIter *iter)
-{
-	g_return_val_if_fail (iter != NULL, NULL);
+	if (n < 0)
+		return FALSE;
 
-	return iter->user_data;
+	iter->user_data = snippets_group_get_nth_snippet (snippets_group, n);
+	return (iter->user_data != NULL);
 }
 
 static GtkTreeModelFlags 
@@ -1764,8 +2916,7 @@ snippets_db_get_iter (GtkTreeModel *tree_model,
 		group_count = indices[1];
 
 	/* Get the top-level iter with the count being db_count */
-	iter_get_first_snippets_db_node (iter, snippets_db);
-	if (!iter_nth (iter, db_count))
+	if (!iter_set_snippets_group_node (iter, snippets_db, db_count))
 		return FALSE;
 
 	/* If depth is SNIPPETS_DB_MODEL_DEPTH, get the group_count'th child */
@@ -1779,46 +2930,22 @@ static GtkTreePath*
 snippets_db_get_path (GtkTreeModel *tree_model,
                       GtkTreeIter *iter)
 {
-	GtkTreePath *path = NULL;
-	GtkTreeIter *iter_copy = NULL;
 	SnippetsDB *snippets_db = NULL;
-	gint count = 0;
-	GList *l_iter = NULL;
+	GObject *cur_object = NULL;
 
 	/* Assertions */
 	g_return_val_if_fail (ANJUTA_IS_SNIPPETS_DB (tree_model), NULL);
 	g_return_val_if_fail (iter != NULL, NULL);
 	snippets_db = ANJUTA_SNIPPETS_DB (tree_model);
 
-	/* Make a new GtkTreePath object */
-	path = gtk_tree_path_new ();
-
-	/* Get the first index */
-	l_iter = iter_get_list_node (iter);
-	while (l_iter != NULL)
-	{
-		count ++;
-		l_iter = g_list_previous (l_iter);
-	}
-	gtk_tree_path_append_index (path, count);
-	
-	/* If it's a snippet node, then it has a parent */
-	count = 0;
-	if (iter_is_snippet_node (iter))
-	{
-		iter_copy = gtk_tree_iter_copy (iter);
-
-		snippets_db_iter_parent (tree_model, iter_copy, iter);
-		l_iter = iter_get_list_node (iter_copy);
-		while (l_iter != NULL)
-		{
-			count ++;
-			l_iter = g_list_previous (l_iter);
-		}
-		gtk_tree_iter_free (iter);
-	}
+	/* The positions are cached in the objects, so we just read them */
+	cur_object = iter_get_data (iter);
+	if (ANJUTA_IS_SNIPPET (cur_object))
+		return get_tree_path_for_snippet (snippets_db, ANJUTA_SNIPPET (cur_object));
+	if (ANJUTA_IS_SNIPPETS_GROUP (cur_object))
+		return get_tree_path_for_snippets_group (snippets_db, ANJUTA_SNIPPETS_GROUP (cur_object));
 
-	return path;
+	return NULL;
 }
 
 static void
@@ -1879,6 +3006,7 @@ snippets_db_iter_next (GtkTreeModel *tree_model,
                        GtkTreeIter *iter)
 {
 	SnippetsDB* snippets_db = NULL;
+	GObject *cur_object = NULL;
 
 	/* Assertions */
 	g_return_val_if_fail (ANJUTA_IS_SNIPPETS_DB (tree_model), FALSE);
@@ -1890,9 +3018,19 @@ snippets_db_iter_next (GtkTreeModel *tree_model,
 	                      FALSE);
 
 	/* Update the iter and return TRUE if it didn't reached the end*/
-	iter->user_data = g_list_next ((GList *)iter->user_data);
-
-	return (iter->user_data != NULL);
+	cur_object = iter_get_data (iter);
+	if (ANJUTA_IS_SNIPPETS_GROUP (cur_object))
+		return iter_set_snippets_group_node (iter, snippets_db,
+		                                     get_snippets_group_position (snippets_db,
+		                                                                  ANJUTA_SNIPPETS_GROUP (cur_object)) + 1);
+	if (ANJUTA_IS_SNIPPET (cur_object))
+		return iter_set_snippet_node (iter, snippets_db,
+		                              ANJUTA_SNIPPETS_GROUP (iter->user_data2),
+		                              snippets_group_get_snippet_position (ANJUTA_SNIPPETS_GROUP (iter->user_data2),
+		                                                                   ANJUTA_SNIPPET (cur_object)) + 1);
+
+	iter->user_data = NULL;
+	return FALSE;
 }
 
 static gboolean
@@ -1907,7 +3045,6 @@ static gboolean
 snippets_db_iter_has_child (GtkTreeModel *tree_model,
                             GtkTreeIter  *iter)
 {
-	GList *snippets_list = NULL;
 	AnjutaSnippetsGroup *snippets_group = NULL;
 
 	/* Assertions */
@@ -1918,8 +3055,7 @@ snippets_db_iter_has_child (GtkTreeModel *tree_model,
 	if (iter_is_snippets_group_node (iter))
 	{
 		snippets_group = ANJUTA_SNIPPETS_GROUP (iter_get_data (iter));
-		snippets_list = (GList *)snippets_group_get_snippets_list (snippets_group);
-		return (g_list_length (snippets_list) != 0);
+		return (snippets_group_get_n_snippets (snippets_group) != 0);
 	}
 	else
 		return FALSE;
@@ -1929,7 +3065,6 @@ static gint
 snippets_db_iter_n_children (GtkTreeModel *tree_model,
                              GtkTreeIter *iter)
 {
-	const GList* snippets_list = NULL;
 	SnippetsDB *snippets_db = NULL;
 	AnjutaSnippetsGroup *snippets_group = NULL;
 
@@ -1940,7 +3075,7 @@ snippets_db_iter_n_children (GtkTreeModel *tree_model,
 	/* If a top-level count is requested */
 	if (iter == NULL)
 	{
-		return (gint)g_list_length (snippets_db->priv->snippets_groups);
+		return (gint)get_n_visible_snippets_groups (snippets_db);
 	}
 
 	/* If iter points to a SnippetsGroup node */
@@ -1951,8 +3086,7 @@ snippets_db_iter_n_children (GtkTreeModel *tree_model,
 		g_return_val_if_fail (ANJUTA_IS_SNIPPETS_GROUP (snippets_group),
 		                      -1);
 
-		snippets_list = snippets_group_get_snippets_list (snippets_group);
-		return (gint)g_list_length ((GList *)snippets_list);
+		return (gint)snippets_group_get_n_snippets (snippets_group);
 	}
 
 	/* If iter points to a Snippet node than it has no children. */
@@ -1973,21 +3107,14 @@ snippets_db_iter_nth_child (GtkTreeModel *tree_model,
 	
 	/* If it's a top level request */
 	if (parent == NULL)
-	{
-		iter_get_first_snippets_db_node (iter, snippets_db);
-		return iter_nth (iter, n);
-	}
+		return iter_set_snippets_group_node (iter, snippets_db, n);
 
 	if (iter_is_snippets_group_node (parent))
 	{
+		/* The parent and iter might be the same GtkTreeIter */
 		AnjutaSnippetsGroup *snippets_group = ANJUTA_SNIPPETS_GROUP (iter_get_data (parent));
-		GList *snippets_list = (GList *)snippets_group_get_snippets_list (snippets_group);
 
-		iter->user_data2 = parent->user_data;
-		iter->user_data  = g_list_first (snippets_list);
-		iter->stamp      = parent->stamp;
-		
-		return iter_nth (iter, n);
+		return iter_set_snippet_node (iter, snippets_db, snippets_group, n);
 	}
 
 	/* If we got to this point, it's a snippet node, so it doesn't have a child*/
@@ -2022,90 +3149,52 @@ static GtkTreePath *
 get_tree_path_for_snippets_group (SnippetsDB *snippets_db,
                                   AnjutaSnippetsGroup *snippets_group)
 {
-	GtkTreeIter iter;
-	gint index = 0;
-	const gchar *group_name = NULL;
-	AnjutaSnippetsGroup *cur_group = NULL;
-	GtkTreePath *path = NULL;
+	gint position = 0;
 
 	/* Assertions */
 	g_return_val_if_fail (ANJUTA_IS_SNIPPETS_DB (snippets_db), NULL);
 	g_return_val_if_fail (ANJUTA_IS_SNIPPETS_GROUP (snippets_group), NULL);
-	                      
-	group_name = snippets_group_get_name (snippets_group);
-	path = gtk_tree_path_new ();
-	
-	if (!iter_get_first_snippets_db_node (&iter, snippets_db))
+
+	/* The position is maintained by the SnippetsDB, so we don't need to search for it */
+	position = get_snippets_group_position (snippets_db, snippets_group);
+	if (position < 0)
 		return NULL;
-		
-	do 
-	{
-		cur_group = ANJUTA_SNIPPETS_GROUP (iter_get_data (&iter));
-		if (!ANJUTA_IS_SNIPPETS_GROUP (cur_group))
-		{
-			index ++;
-			continue;
-		}
-		
-		if (!g_strcmp0 (snippets_group_get_name (cur_group), group_name))
-		{
-			gtk_tree_path_append_index (path, index);		
-			return path;
-		}
-		index ++;
-		
-	} while (snippets_db_iter_next (GTK_TREE_MODEL (snippets_db), &iter));
 
-	gtk_tree_path_free (path);
-	return NULL;
+	return gtk_tree_path_new_from_indices (position, -1);
 }
 
 static GtkTreePath *
 get_tree_path_for_snippet (SnippetsDB *snippets_db,
                            AnjutaSnippet *snippet)
 {
-	GtkTreePath *path = NULL;
-	gint index1 = 0, index2 = 0;
-	GtkTreeIter iter1, iter2;
-	AnjutaSnippet *cur_snippet = NULL;
+	AnjutaSnippet *stored_snippet = NULL;
+	gint snippet_position = 0, group_position = 0;
 
 	/* Assertions */
 	g_return_val_if_fail (ANJUTA_IS_SNIPPETS_DB (snippets_db), NULL);
 	g_return_val_if_fail (ANJUTA_IS_SNIPPET (snippet), NULL);
 
-	path = gtk_tree_path_new ();
+	/* If the snippet isn't the one stored in the database (for example, it's a copy),
+	   we get the stored snippet with the same identifier. */
+	stored_snippet   = snippet;
+	snippet_position = get_snippet_position (snippet);
+	if (snippet_position < 0)
+	{
+		stored_snippet = lookup_snippet_in_hash_table (snippets_db,
+		                                               snippet_get_trigger_key (snippet),
+		                                               snippet_get_any_language (snippet));
+		if (!ANJUTA_IS_SNIPPET (stored_snippet))
+			return NULL;
 
-	if (!iter_get_first_snippets_db_node (&iter1, snippets_db))
-		return NULL;
+		snippet_position = get_snippet_position (stored_snippet);
+		if (snippet_position < 0)
+			return NULL;
+	}
 
-	do
-	{
-		index2 = 0;
-		snippets_db_iter_nth_child (GTK_TREE_MODEL (snippets_db), &iter2, &iter1, 0);
-		
-		do
-		{
-			cur_snippet = ANJUTA_SNIPPET (iter_get_data (&iter2));
-			if (!ANJUTA_IS_SNIPPET (cur_snippet))
-			{
-				index2 ++;
-				continue;
-			}
-			if (snippet_is_equal (snippet, cur_snippet))
-			{
-				gtk_tree_path_append_index (path, index1);
-				gtk_tree_path_append_index (path, index2);
-				return path;
-			}
-			
-			index2 ++;
-			
-		} while (snippets_db_iter_next (GTK_TREE_MODEL (snippets_db), &iter2));
-		
-		index1 ++;
-		
-	} while (snippets_db_iter_next (GTK_TREE_MODEL (snippets_db), &iter1));
+	group_position = get_snippets_group_position (snippets_db,
+	                                              ANJUTA_SNIPPETS_GROUP (stored_snippet->parent_snippets_group));
+	if (group_position < 0)
+		return NULL;
 
-	gtk_tree_path_free (path);
-	return NULL;
+	return gtk_tree_path_new_from_indices (group_position, snippet_position, -1);
 }
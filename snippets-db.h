@@ -87,6 +87,56 @@ struct _SnippetsDBClass
 
 };
 
+/**
+ * SnippetsDBSnapshotEntry:
+ * @snippet: The #AnjutaSnippet object. The snapshot holds a reference to it, but it
+ *           should only be used from the main loop.
+ * @name: The name of the snippet.
+ * @search_trigger_key: The lower-cased trigger-key of the snippet.
+ * @search_name: The lower-cased name of the snippet.
+ * @search_keywords: A NULL-terminated array with the lower-cased keywords of the snippet.
+ * @search_chars_mask: The mask of the characters in the search fields
+ *                     (see #snippet_get_search_chars_mask).
+ * @search_lengths: The lengths of the search fields (see #snippet_get_search_lengths).
+ * @n_search_lengths: The number of values in @search_lengths.
+ *
+ * A frozen copy of the data of a snippet used for searching, owned by a
+ * #SnippetsDBSnapshot. Unlike the @snippet, it can be read from any thread.
+ */
+typedef struct _SnippetsDBSnapshotEntry
+{
+	AnjutaSnippet *snippet;
+	gchar *name;
+	gchar *search_trigger_key;
+	gchar *search_name;
+	gchar **search_keywords;
+	guint64 search_chars_mask;
+	guint *search_lengths;
+	guint n_search_lengths;
+} SnippetsDBSnapshotEntry;
+
+/**
+ * SnippetsDBSnapshot:
+ * @generation: The generation of the #SnippetsDB when the snapshot was taken.
+ * @entries: The snippets, in the order of the #SnippetsDB tree model.
+ * @n_entries: The number of snippets.
+ *
+ * An immutable, reference counted copy of the #SnippetsDB contents. A snapshot can
+ * be read from any thread without locking while the #SnippetsDB keeps changing.
+ */
+typedef struct _SnippetsDBSnapshot
+{
+	guint generation;
+
+	SnippetsDBSnapshotEntry *entries;
+	guint n_entries;
+
+	/*< private >*/
+	guint *groups_offsets;
+	guint n_groups;
+	volatile gint ref_count;
+} SnippetsDBSnapshot;
+
 typedef enum
 {
 	NATIVE_FORMAT = 0,
@@ -99,6 +149,11 @@ SnippetsDB*                snippets_db_new                    (void);
 
 void                       snippets_db_load                   (SnippetsDB *snippets_db);
 void                       snippets_db_close                  (SnippetsDB *snippets_db);
+void                       snippets_db_set_current_language   (SnippetsDB *snippets_db,
+                                                               const gchar *language);
+const gchar*               snippets_db_get_current_language   (SnippetsDB *snippets_db);
+void                       snippets_db_begin_batch            (SnippetsDB *snippets_db);
+void                       snippets_db_end_batch              (SnippetsDB *snippets_db);
 
 GtkTreePath *              snippets_db_get_path_at_object     (SnippetsDB *snippets_db,
                                                                GObject *obj);
@@ -115,6 +170,13 @@ gboolean                   snippets_db_has_snippet            (SnippetsDB *snipp
 AnjutaSnippet*             snippets_db_get_snippet            (SnippetsDB* snippets_db,
                                                                const gchar* trigger_key,
                                                                const gchar* language);
+AnjutaSnippet**            snippets_db_get_snippets_for_language (SnippetsDB *snippets_db,
+                                                                  const gchar *language,
+                                                                  const gchar *trigger_prefix,
+                                                                  guint *n_snippets);
+GPtrArray*                 snippets_db_get_snippets_containing_words (SnippetsDB *snippets_db,
+                                                                      const gchar *language,
+                                                                      GList *words);
 gboolean                   snippets_db_remove_snippet         (SnippetsDB* snippets_db,
                                                                const gchar* trigger_key,
                                                                const gchar* language,
@@ -151,6 +213,9 @@ gboolean                   snippets_db_set_global_variable_type  (SnippetsDB *sn
                                                                   gboolean is_command);                                                             
 gchar*                     snippets_db_get_global_variable       (SnippetsDB* snippets_db,
                                                                   const gchar* variable_name);
+gchar**                    snippets_db_get_global_variables      (SnippetsDB *snippets_db,
+                                                                  const gchar **variable_names,
+                                                                  guint n_variables);
 gchar*                     snippets_db_get_global_variable_text  (SnippetsDB* snippets_db,
                                                                   const gchar* variable_name);
 gboolean                   snippets_db_remove_global_variable    (SnippetsDB* snippets_db,
@@ -159,6 +224,15 @@ gboolean                   snippets_db_has_global_variable       (SnippetsDB* sn
                                                                   const gchar* variable_name);
 GtkTreeModel*              snippets_db_get_global_vars_model     (SnippetsDB* snippes_db);
 
+/* Snapshots */
+guint                      snippets_db_get_generation            (SnippetsDB *snippets_db);
+SnippetsDBSnapshot*        snippets_db_get_snapshot              (SnippetsDB *snippets_db);
+SnippetsDBSnapshot*        snippets_db_snapshot_ref              (SnippetsDBSnapshot *snapshot);
+void                       snippets_db_snapshot_unref            (SnippetsDBSnapshot *snapshot);
+const SnippetsDBSnapshotEntry*
+                           snippets_db_snapshot_get_entry        (SnippetsDBSnapshot *snapshot,
+                                                                  AnjutaSnippet *snippet);
+
 G_END_DECLS
 
 #endif /* __SNIPPETS_DB_H__ */
@@ -1380,6 +1380,7 @@ load_content_to_editor (SnippetsEditor *snippets_editor)
 	SnippetsEditorPrivate *priv = NULL;
 	gchar *text = NULL;
 	GtkTextBuffer *content_buffer = NULL;
+	AnjutaSnippetExpansion *expansion = NULL;
 	
 	/* Assertions */
 	g_return_if_fail (ANJUTA_IS_SNIPPETS_EDITOR (snippets_editor));
@@ -1393,9 +1394,10 @@ load_content_to_editor (SnippetsEditor *snippets_editor)
 	else
 	if (gtk_toggle_button_get_active (priv->preview_button))
 	{
-		text = snippet_get_default_content (priv->snippet,
-		                                    G_OBJECT (priv->snippets_db),
-		                                    "");
+		/* The preview doesn't need the variable positions kept by the snippet */
+		expansion = snippet_expand (priv->snippet, G_OBJECT (priv->snippets_db), "");
+		text = g_strdup (expansion->text);
+		snippet_expansion_free (expansion);
 	}
 	else
 	{
@@ -25,11 +25,27 @@
 
 #define ANJUTA_SNIPPETS_GROUP_GET_PRIVATE(obj) (G_TYPE_INSTANCE_GET_PRIVATE ((obj), ANJUTA_TYPE_SNIPPETS_GROUP, AnjutaSnippetsGroupPrivate))
 
+/**
+ * AnjutaSnippetsGroupPrivate:
+ * @name: The name of the group.
+ * @snippets: A #GPtrArray with the #AnjutaSnippet objects of the group, sorted by name.
+ *            Each snippet has the index in this array cached in it's position field.
+ * @stale_positions_start: The index in @snippets from which the cached positions are
+ *                         out of date, or -1 if they are all up to date. They are
+ *                         recomputed when one of them is read, so a run of insertions
+ *                         and removals walks @snippets only once.
+ * @snippet_keys: A #GHashTable with #SnippetKey structures as keys and pointers to
+ *                the #AnjutaSnippet objects in @snippets as values. It's used for
+ *                answering conflict checks without walking @snippets.
+ */
 struct _AnjutaSnippetsGroupPrivate
 {
 	gchar* name;
 	
-	GList* snippets;
+	GPtrArray* snippets;
+	gint stale_positions_start;
+
+	GHashTable* snippet_keys;
 };
 
 
@@ -38,22 +54,30 @@ G_DEFINE_TYPE (AnjutaSnippetsGroup, snippets_group, G_TYPE_OBJECT);
 static void
 snippets_group_dispose (GObject* snippets_group)
 {
-	AnjutaSnippetsGroup *anjuta_snippets_group = ANJUTA_SNIPPETS_GROUP (snippets_group);
 	AnjutaSnippetsGroupPrivate *priv = ANJUTA_SNIPPETS_GROUP_GET_PRIVATE (snippets_group);
 	AnjutaSnippet *cur_snippet = NULL;
-	GList *iter = NULL;
+	guint i = 0;
 
 	/* Delete the name and description fields */
 	g_free (priv->name);
 	priv->name = NULL;
 	
 	/* Delete the snippets in the group */
-	for (iter = g_list_first (priv->snippets); iter != NULL; iter = g_list_next (iter))
+	if (priv->snippets != NULL)
 	{
-		cur_snippet = (AnjutaSnippet *)iter->data;
-		g_object_unref (cur_snippet);
+		for (i = 0; i < priv->snippets->len; i ++)
+		{
+			cur_snippet = (AnjutaSnippet *)g_ptr_array_index (priv->snippets, i);
+			g_object_unref (cur_snippet);
+		}
+		g_ptr_array_free (priv->snippets, TRUE);
 	}
-	g_list_free (anjuta_snippets_group->priv->snippets);
+	priv->snippets = NULL;
+
+	/* Delete the snippet keys index */
+	if (priv->snippet_keys != NULL)
+		g_hash_table_destroy (priv->snippet_keys);
+	priv->snippet_keys = NULL;
 	
 	G_OBJECT_CLASS (snippets_group_parent_class)->dispose (snippets_group);
 }
@@ -81,10 +105,16 @@ snippets_group_init (AnjutaSnippetsGroup* snippets_group)
 	AnjutaSnippetsGroupPrivate* priv = ANJUTA_SNIPPETS_GROUP_GET_PRIVATE (snippets_group);
 	
 	snippets_group->priv = priv;
+	snippets_group->position = -1;
 
 	/* Initialize the private field */
 	priv->name = NULL;
-	priv->snippets = NULL;
+	priv->snippets = g_ptr_array_new ();
+	priv->stale_positions_start = -1;
+	priv->snippet_keys = g_hash_table_new_full (snippet_key_hash,
+	                                            snippet_key_equal,
+	                                            snippet_key_free,
+	                                            NULL);
 }
 
 /**
@@ -135,6 +165,68 @@ snippets_group_set_name (AnjutaSnippetsGroup* snippets_group,
 	snippets_group->priv->name = g_strdup (new_group_name);
 }
 
+static void
+add_snippet_to_keys_index (AnjutaSnippetsGroup *snippets_group,
+                           AnjutaSnippet *snippet)
+{
+	GList *iter = NULL;
+	const gchar *trigger_key = NULL;
+	SnippetKey snippet_key;
+
+	trigger_key = snippet_get_trigger_key (snippet);
+	for (iter = (GList *)snippet_get_languages (snippet); iter != NULL; iter = g_list_next (iter))
+	{
+		if (!snippet_key_init (&snippet_key, trigger_key, (const gchar *)iter->data, TRUE))
+			continue;
+
+		g_hash_table_insert (snippets_group->priv->snippet_keys,
+		                     g_slice_dup (SnippetKey, &snippet_key),
+		                     snippet);
+	}
+}
+
+static void
+remove_snippet_from_keys_index (AnjutaSnippetsGroup *snippets_group,
+                                AnjutaSnippet *snippet)
+{
+	GList *iter = NULL;
+	const gchar *trigger_key = NULL;
+	SnippetKey snippet_key;
+
+	trigger_key = snippet_get_trigger_key (snippet);
+	for (iter = (GList *)snippet_get_languages (snippet); iter != NULL; iter = g_list_next (iter))
+	{
+		if (!snippet_key_init (&snippet_key, trigger_key, (const gchar *)iter->data, FALSE))
+			continue;
+
+		g_hash_table_remove (snippets_group->priv->snippet_keys, &snippet_key);
+	}
+}
+
+static void
+invalidate_snippets_positions (AnjutaSnippetsGroup *snippets_group,
+                               guint start_position)
+{
+	AnjutaSnippetsGroupPrivate *priv = snippets_group->priv;
+
+	if (priv->stale_positions_start < 0 || start_position < (guint)priv->stale_positions_start)
+		priv->stale_positions_start = start_position;
+}
+
+static void
+update_snippets_positions (AnjutaSnippetsGroup *snippets_group)
+{
+	AnjutaSnippetsGroupPrivate *priv = snippets_group->priv;
+	guint i = 0;
+
+	if (priv->stale_positions_start < 0)
+		return;
+
+	for (i = priv->stale_positions_start; i < priv->snippets->len; i ++)
+		((AnjutaSnippet *)g_ptr_array_index (priv->snippets, i))->position = i;
+	priv->stale_positions_start = -1;
+}
+
 static gint
 compare_snippets_by_name (gconstpointer a,
                           gconstpointer b)
@@ -150,6 +242,33 @@ compare_snippets_by_name (gconstpointer a,
 	                       snippet_get_name (snippet_b));
 }
 
+static guint
+get_insert_position_for_snippet (AnjutaSnippetsGroup *snippets_group,
+                                 AnjutaSnippet *snippet)
+{
+	GPtrArray *snippets = snippets_group->priv->snippets;
+	guint low = 0, high = 0, middle = 0;
+
+	/* Snippets are usually added in order (as they were saved), so first we check
+	   if we can just append it */
+	if (snippets->len == 0 ||
+	    compare_snippets_by_name (g_ptr_array_index (snippets, snippets->len - 1), snippet) <= 0)
+		return snippets->len;
+
+	/* Binary search for the first snippet which comes after the given one */
+	high = snippets->len;
+	while (low < high)
+	{
+		middle = (low + high) / 2;
+		if (compare_snippets_by_name (g_ptr_array_index (snippets, middle), snippet) <= 0)
+			low = middle + 1;
+		else
+			high = middle;
+	}
+
+	return low;
+}
+
 /**
  * snippets_group_add_snippet:
  * @snippets_group: A #AnjutaSnippetsGroup object.
@@ -164,6 +283,7 @@ snippets_group_add_snippet (AnjutaSnippetsGroup* snippets_group,
                             AnjutaSnippet* snippet)
 {
 	AnjutaSnippetsGroupPrivate *priv = NULL;
+	guint position = 0;
 	
 	/* Assertions */
 	g_return_val_if_fail (ANJUTA_IS_SNIPPETS_GROUP (snippets_group), FALSE);
@@ -175,11 +295,19 @@ snippets_group_add_snippet (AnjutaSnippetsGroup* snippets_group,
 	if (snippets_group_has_snippet (snippets_group, snippet))
 		return FALSE;
 	
-	/* Add the new snippet to the group */
-	priv->snippets = g_list_insert_sorted (snippets_group->priv->snippets,
-	                                       snippet,
-	                                       compare_snippets_by_name);
+	/* Add the new snippet to the group, keeping the array sorted */
+	position = get_insert_position_for_snippet (snippets_group, snippet);
+	g_ptr_array_add (priv->snippets, snippet);
+	if (position < priv->snippets->len - 1)
+	{
+		g_memmove (&priv->snippets->pdata[position + 1],
+		           &priv->snippets->pdata[position],
+		           (priv->snippets->len - position - 1) * sizeof (gpointer));
+		priv->snippets->pdata[position] = snippet;
+	}
+	add_snippet_to_keys_index (snippets_group, snippet);
 	snippet->parent_snippets_group = G_OBJECT (snippets_group);
+	invalidate_snippets_positions (snippets_group, position);
 
 	return TRUE;
 }
@@ -202,85 +330,141 @@ snippets_group_remove_snippet (AnjutaSnippetsGroup* snippets_group,
                                gboolean remove_all_languages_support)
 {
 
-	GList *iter = NULL;
-	AnjutaSnippet *to_be_deleted_snippet = NULL, *cur_snippet;
-	const gchar *cur_snippet_trigger = NULL;
+	AnjutaSnippet *cur_snippet = NULL;
 	AnjutaSnippetsGroupPrivate *priv = NULL;
+	SnippetKey snippet_key;
+	guint position = 0;
 	
 	/* Assertions */
 	g_return_if_fail (ANJUTA_IS_SNIPPETS_GROUP (snippets_group));
 	g_return_if_fail (trigger_key != NULL);
 	priv = ANJUTA_SNIPPETS_GROUP_GET_PRIVATE (snippets_group);
 	
-	/* Check if there is a snippet with the same key */
-	for (iter = g_list_first (priv->snippets); iter != NULL; iter = g_list_next (iter))
+	/* Look up the snippet with the given key */
+	if (!snippet_key_init (&snippet_key, trigger_key, language, FALSE))
+		return;
+	cur_snippet = g_hash_table_lookup (priv->snippet_keys, &snippet_key);
+	if (!ANJUTA_IS_SNIPPET (cur_snippet))
+		return;
+
+	if (remove_all_languages_support)
 	{
-		cur_snippet = ANJUTA_SNIPPET (iter->data);
-		if (!ANJUTA_IS_SNIPPET (cur_snippet))
-			g_return_if_reached ();
-		cur_snippet_trigger = snippet_get_trigger_key (cur_snippet);
-		
-		if (!g_strcmp0 (cur_snippet_trigger, trigger_key) &&
-		    snippet_has_language (cur_snippet, language))
-		{
-			if (remove_all_languages_support)
-			{
-				to_be_deleted_snippet = cur_snippet;
-				break;
-			}
-			else
-			{
-				snippet_remove_language (cur_snippet, language);
-				return;
-			}
-		}
-		
+		/* We remove it from the list and unref it */
+		position = snippets_group_get_snippet_position (snippets_group, cur_snippet);
+		g_return_if_fail (g_ptr_array_index (priv->snippets, position) == cur_snippet);
+
+		remove_snippet_from_keys_index (snippets_group, cur_snippet);
+		g_ptr_array_remove_index (priv->snippets, position);
+		cur_snippet->position = -1;
+		invalidate_snippets_positions (snippets_group, position);
+		g_object_unref (cur_snippet);
 	}
-
-	/* If we found a snippet that should be deleted we remove it from the list and unref it */
-	if (to_be_deleted_snippet)
+	else
 	{
-		priv->snippets = g_list_remove (priv->snippets, to_be_deleted_snippet);
-		g_object_unref (to_be_deleted_snippet);
-
+		g_hash_table_remove (priv->snippet_keys, &snippet_key);
+		snippet_remove_language (cur_snippet, language);
 	}
-	
 }
 
+/**
+ * snippets_group_has_snippet:
+ * @snippets_group: A #AnjutaSnippetsGroup object.
+ * @snippet: A #AnjutaSnippet object.
+ *
+ * Checks if the group has a snippet with the same trigger-key and at least one common
+ * language (see #snippet_is_equal).
+ *
+ * Returns: TRUE if there is such a snippet in the group.
+ **/
 gboolean
 snippets_group_has_snippet (AnjutaSnippetsGroup *snippets_group,
                             AnjutaSnippet *snippet)
 {
 	AnjutaSnippetsGroupPrivate *priv = NULL;
 	GList *iter = NULL;
+	const gchar *trigger_key = NULL;
+	SnippetKey snippet_key;
+	gboolean found = FALSE;
 
 	/* Assertions */
 	g_return_val_if_fail (ANJUTA_IS_SNIPPETS_GROUP (snippets_group), FALSE);
 	g_return_val_if_fail (ANJUTA_IS_SNIPPET (snippet), FALSE);
 	priv = ANJUTA_SNIPPETS_GROUP_GET_PRIVATE (snippets_group);
 
-	for (iter = g_list_first (priv->snippets); iter != NULL; iter = g_list_next (iter))
+	trigger_key = snippet_get_trigger_key (snippet);
+	for (iter = (GList *)snippet_get_languages (snippet); iter != NULL && !found; iter = g_list_next (iter))
 	{
-		if (!ANJUTA_IS_SNIPPET (iter->data))
+		if (!snippet_key_init (&snippet_key, trigger_key, (const gchar *)iter->data, FALSE))
 			continue;
-		if (snippet_is_equal (snippet, ANJUTA_SNIPPET (iter->data)))
-			return TRUE;
+
+		found = (g_hash_table_lookup (priv->snippet_keys, &snippet_key) != NULL);
 	}
 
-	return FALSE;
+	return found;
+}
+
+/**
+ * snippets_group_get_n_snippets:
+ * @snippets_group: A #AnjutaSnippetsGroup object.
+ *
+ * Returns: The number of snippets in the group.
+ **/
+guint
+snippets_group_get_n_snippets (AnjutaSnippetsGroup *snippets_group)
+{
+	/* Assertions */
+	g_return_val_if_fail (ANJUTA_IS_SNIPPETS_GROUP (snippets_group), 0);
+
+	return snippets_group->priv->snippets->len;
+}
+
+/**
+ * snippets_group_get_nth_snippet:
+ * @snippets_group: A #AnjutaSnippetsGroup object.
+ * @n: The index of the requested snippet.
+ *
+ * Gets the snippet at the given index. The snippets are sorted by their name.
+ *
+ * Returns: The requested #AnjutaSnippet (not a copy) or NULL if @n is out of range.
+ **/
+AnjutaSnippet*
+snippets_group_get_nth_snippet (AnjutaSnippetsGroup *snippets_group,
+                                guint n)
+{
+	GPtrArray *snippets = NULL;
+
+	/* Assertions */
+	g_return_val_if_fail (ANJUTA_IS_SNIPPETS_GROUP (snippets_group), NULL);
+	snippets = snippets_group->priv->snippets;
+
+	if (n >= snippets->len)
+		return NULL;
+
+	return ANJUTA_SNIPPET (g_ptr_array_index (snippets, n));
 }
 
 /**
- * snippets_group_get_snippets_list:
+ * snippets_group_get_snippet_position:
  * @snippets_group: A #AnjutaSnippetsGroup object.
+ * @snippet: A #AnjutaSnippet object.
  *
- * Gets the snippets in this group.
- * Important: This returns the actual list as saved in the #AnjutaSnippetsGroup.
+ * Gets the index of the snippet in the group, bringing the cached positions up to
+ * date first if the group changed since they were last read.
  *
- * Returns: A #GList with entries of type #AnjutaSnippet.
+ * Returns: The index of @snippet or -1 if it isn't stored in @snippets_group.
  **/
-GList* 
-snippets_group_get_snippets_list (AnjutaSnippetsGroup* snippets_group)
+gint
+snippets_group_get_snippet_position (AnjutaSnippetsGroup *snippets_group,
+                                     AnjutaSnippet *snippet)
 {
-	return snippets_group->priv->snippets;
+	/* Assertions */
+	g_return_val_if_fail (ANJUTA_IS_SNIPPETS_GROUP (snippets_group), -1);
+	g_return_val_if_fail (ANJUTA_IS_SNIPPET (snippet), -1);
+
+	if (snippet->parent_snippets_group != G_OBJECT (snippets_group))
+		return -1;
+
+	update_snippets_positions (snippets_group);
+
+	return snippet->position;
 }
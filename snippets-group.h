@@ -41,6 +41,11 @@ typedef struct _AnjutaSnippetsGroupClass AnjutaSnippetsGroupClass;
 struct _AnjutaSnippetsGroup
 {
 	GObject parent_instance;
+
+	/* The index of the group in the SnippetsDB or -1 if it isn't stored in one.
+	   This is maintained lazily by the SnippetsDB, which brings it up to date
+	   before reading it. */
+	gint position;
 	
 	/*< private >*/
 	AnjutaSnippetsGroupPrivate* priv;
@@ -65,7 +70,11 @@ void                  snippets_group_remove_snippet    (AnjutaSnippetsGroup* sni
                                                         gboolean remove_all_languages_support);
 gboolean              snippets_group_has_snippet       (AnjutaSnippetsGroup *snippets_group,
                                                         AnjutaSnippet *snippet);
-GList*                snippets_group_get_snippets_list (AnjutaSnippetsGroup* snippets_group);
+guint                 snippets_group_get_n_snippets    (AnjutaSnippetsGroup *snippets_group);
+AnjutaSnippet*        snippets_group_get_nth_snippet   (AnjutaSnippetsGroup *snippets_group,
+                                                        guint n);
+gint                  snippets_group_get_snippet_position (AnjutaSnippetsGroup *snippets_group,
+                                                           AnjutaSnippet *snippet);
 
 G_END_DECLS
 
@@ -121,7 +121,7 @@ static void      on_cur_editor_cursor_moved     (IAnjutaEditor *cur_editor,
 static void      delete_snippet_editing_info    (SnippetsInteraction *snippets_interaction);
 static void      start_snippet_editing_session  (SnippetsInteraction *snippets_interaction,
                                                  IAnjutaIterable *start_pos,
-                                                 gint len);
+                                                 AnjutaSnippetExpansion *expansion);
 static void      stop_snippet_editing_session   (SnippetsInteraction *snippets_interaction);
 
 
@@ -592,13 +592,12 @@ sort_variables (gconstpointer a,
 static void
 start_snippet_editing_session (SnippetsInteraction *snippets_interaction,
                                IAnjutaIterable *start_pos,
-                               gint len)
+                               AnjutaSnippetExpansion *expansion)
 {
 	SnippetsInteractionPrivate *priv = NULL;
-	gint finish_position = -1, cur_var_length = -1, i = 0, cur_appearance_pos = 0;
-	GList *relative_positions = NULL, *variables_length = NULL,
-	      *iter = NULL, *iter2 = NULL;
-	GPtrArray *cur_var_positions = NULL;
+	gint finish_position = -1, len = 0, i = 0, cur_appearance_pos = 0;
+	guint j = 0;
+	AnjutaSnippetExpandedVariable *cur_var = NULL;
 	SnippetVariableInfo *cur_var_info = NULL;
 
 	/* Assertions */
@@ -606,6 +605,9 @@ start_snippet_editing_session (SnippetsInteraction *snippets_interaction,
 	priv = ANJUTA_SNIPPETS_INTERACTION_GET_PRIVATE (snippets_interaction);
 	g_return_if_fail (ANJUTA_IS_SNIPPET (priv->cur_snippet));
 	g_return_if_fail (IANJUTA_IS_EDITOR (priv->cur_editor));
+	g_return_if_fail (expansion != NULL);
+
+	len = strlen (expansion->text);
 
 	/* Mark the editing session */
 	priv->editing = TRUE;
@@ -621,7 +623,7 @@ start_snippet_editing_session (SnippetsInteraction *snippets_interaction,
 	                               ianjuta_iterable_get_position (start_pos, NULL) + len,
 	                               NULL);
 
-	finish_position = snippet_get_cur_value_end_position (priv->cur_snippet);
+	finish_position = expansion->end_position;
 	if (finish_position >= 0)
 	{
 		priv->editing_info->snippet_finish_position = ianjuta_iterable_clone (start_pos, NULL);
@@ -635,34 +637,24 @@ start_snippet_editing_session (SnippetsInteraction *snippets_interaction,
 	}
 
 	/* Calculate positions of each variable appearance */
-	relative_positions = snippet_get_variable_relative_positions (priv->cur_snippet);
-	variables_length   = snippet_get_variable_cur_values_len (priv->cur_snippet);
-
-	iter  = g_list_first (relative_positions);
-	iter2 = g_list_first (variables_length);
-	while (iter != NULL && iter2 != NULL)
+	for (j = 0; j < expansion->n_variables; j ++)
 	{
-		cur_var_positions = (GPtrArray *)iter->data;
-		cur_var_length    = GPOINTER_TO_INT (iter2->data);
+		cur_var = &expansion->variables[j];
 
 		/* If the variable doesn't have any appearance, we don't add it */
-		if (!cur_var_positions->len)
-		{
-			iter  = g_list_next (iter);
-			iter2 = g_list_next (iter2);
+		if (!cur_var->positions->len)
 			continue;
-		}
 
 		/* Initialize the current variable info */
 		cur_var_info = g_new0 (SnippetVariableInfo, 1);
-		cur_var_info->cur_value_length = cur_var_length;
+		cur_var_info->cur_value_length = cur_var->value_len;
 		cur_var_info->appearances      = NULL;
 
 		/* Add each variable appearance relative positions */
-		for (i = 0; i < cur_var_positions->len; i ++)
+		for (i = 0; i < cur_var->positions->len; i ++)
 		{
 			IAnjutaIterable *new_iter = NULL;
-			cur_appearance_pos = GPOINTER_TO_INT (g_ptr_array_index (cur_var_positions, i));
+			cur_appearance_pos = g_array_index (cur_var->positions, gint, i);
 			new_iter = ianjuta_iterable_clone (start_pos, NULL);
 			ianjuta_iterable_set_position (new_iter,
 			                               ianjuta_iterable_get_position (new_iter, NULL) + cur_appearance_pos,
@@ -671,17 +663,11 @@ start_snippet_editing_session (SnippetsInteraction *snippets_interaction,
 			cur_var_info->appearances = g_list_append (cur_var_info->appearances,
 			                                           new_iter);
 		}
-		
-		g_ptr_array_unref (cur_var_positions);
-		iter  = g_list_next (iter);
-		iter2 = g_list_next (iter2);
 
 		priv->editing_info->snippet_vars_info = g_list_append (priv->editing_info->snippet_vars_info,
 		                                                       cur_var_info);
 
 	}
-	g_list_free (relative_positions);
-	g_list_free (variables_length);
 
 	/* Sort the list with appearances so the user will edit the ones that appear first
 	   when the editing starts. */
@@ -755,7 +741,8 @@ snippets_interaction_insert_snippet (SnippetsInteraction *snippets_interaction,
                                      AnjutaSnippet *snippet)
 {
 	SnippetsInteractionPrivate *priv = NULL;
-	gchar *indent = NULL, *cur_line = NULL, *snippet_default_content = NULL;
+	gchar *indent = NULL, *cur_line = NULL;
+	AnjutaSnippetExpansion *expansion = NULL;
 	IAnjutaIterable *line_begin = NULL, *cur_pos = NULL;
 	gint cur_line_no = -1, i = 0;
 
@@ -780,17 +767,15 @@ snippets_interaction_insert_snippet (SnippetsInteraction *snippets_interaction,
 		i ++;
 	indent[i] = 0;
 
-	/* Get the default content of the snippet */
-	snippet_default_content = snippet_get_default_content (snippet, 
-	                                                       G_OBJECT (snippets_db), 
-	                                                       indent);
-	g_return_if_fail (snippet_default_content != NULL);
+	/* Get the default content of the snippet, with the positions of its variables */
+	expansion = snippet_expand (snippet, G_OBJECT (snippets_db), indent);
+	g_return_if_fail (expansion != NULL);
 	
 	/* Insert the default content into the editor */
 	ianjuta_document_begin_undo_action (IANJUTA_DOCUMENT (priv->cur_editor), NULL);
 	ianjuta_editor_insert (priv->cur_editor, 
 	                       cur_pos, 
-	                       snippet_default_content, 
+	                       expansion->text, 
 	                       -1,
 	                       NULL);
 	ianjuta_document_end_undo_action (IANJUTA_DOCUMENT (priv->cur_editor), NULL);
@@ -799,10 +784,10 @@ snippets_interaction_insert_snippet (SnippetsInteraction *snippets_interaction,
 	priv->cur_snippet = snippet;
 	start_snippet_editing_session (snippets_interaction, 
 	                               cur_pos, 
-	                               strlen (snippet_default_content));
+	                               expansion);
 
 	g_free (indent);
-	g_free (snippet_default_content);
+	snippet_expansion_free (expansion);
 	g_object_unref (line_begin);
 	g_object_unref (cur_pos);
 	
@@ -19,6 +19,8 @@
 	Boston, MA  02110-1301  USA
 */
 
+#include <stdlib.h>
+#include <string.h>
 #include <libanjuta/interfaces/ianjuta-provider.h>
 #include <libanjuta/interfaces/ianjuta-editor.h>
 #include <libanjuta/interfaces/ianjuta-document-manager.h>
@@ -28,15 +30,17 @@
 #include "snippets-provider.h"
 #include "snippet.h"
 #include "snippets-group.h"
+#include "snippets-search.h"
 
 
-#define TRIGGER_RELEVANCE        1000
-#define NAME_RELEVANCE           1000
-#define FIRST_KEYWORD_RELEVANCE  100
-#define KEYWORD_RELEVANCE_DEC    5
-#define START_MATCH_BONUS        1.7
+/* Guards the relevance bounds against rounding, as they are summed differently */
+#define RELEVANCE_BOUND_SLACK    (1.0 + 1e-9)
 
-#define RELEVANCE(search_str_len, key_len)  ((gdouble)(search_str_len)/(key_len - search_str_len + 1))
+#define DEFAULT_MAX_PROPOSALS    50
+#define PREVIEW_PAGE_SIZE        10
+
+#define COMPLETION_DEBOUNCE_MS             40
+#define COMPLETION_CANCEL_CHECK_INTERVAL   256
 
 #define IS_SEPARATOR(c)          ((c == ' ') || (c == '\n') || (c == '\t'))
 
@@ -56,14 +60,90 @@ struct _SnippetsProviderPrivate
 	IAnjutaIterable *start_iter;
 	GList *suggestions_list;
 
+	/* The snapshot the proposals in the suggestions list point into */
+	SnippetsDBSnapshot *proposals_snapshot;
+
+	/* The list nodes of the cleared proposals (ProposalSlot), reused for the
+	   next proposals instead of allocating new ones */
+	GList *proposals_pool;
+	guint max_proposals;
+
+	SnippetsProviderScoring scoring;
+
+	/* The snippets are scored in a completion thread. The words typed at the last
+	   populate call are searched once the user pauses typing. The job generation
+	   is increased each time the running job becomes stale. */
+	GThreadPool *completion_pool;
+	guint debounce_source_id;
+	guint job_generation;
+	GCancellable *job_cancellable;
+	GList *pending_words;
+	IAnjutaIterable *pending_cursor;
+
+	/* All the relevant snippets (SnippetEntry) for the typed text. The suggestions
+	   list only holds the most relevant max_proposals of them. */
+	GArray *candidates;
+
+	/* The words, language and database snapshot for which the candidates were
+	   found. They are used to narrow the previous candidates as the user continues
+	   typing, instead of scanning the whole database again. */
+	gboolean suggestions_valid;
+	GList *suggestions_words;
+	const gchar *suggestions_language;
+	SnippetsDBSnapshot *suggestions_snapshot;
+
 };
 
 typedef struct _SnippetEntry
 {
-	AnjutaSnippet *snippet;
+	const SnippetsDBSnapshotEntry *snapshot_entry;
 	gdouble relevance;
 } SnippetEntry;
 
+/* A proposal and the entry it holds as data, allocated together */
+typedef struct _ProposalSlot
+{
+	IAnjutaEditorAssistProposal proposal;
+	SnippetEntry entry;
+} ProposalSlot;
+
+typedef struct _CompletionJob
+{
+	SnippetsProvider *snippets_provider;
+	guint generation;
+	GCancellable *cancellable;
+
+	/* The scored snippets. Only their frozen search fields are read. */
+	SnippetsDBSnapshot *snapshot;
+
+	/* The entries of the snapshot to be scored. If it's NULL, all of them are
+	   scored. */
+	GPtrArray *entries;
+	const gchar *language;
+	GList *words_list;
+	guint64 words_chars_mask;
+	SnippetsProviderScoring scoring;
+	guint max_proposals;
+
+	/* The lengths and the smallest periods of the words, used to bound the
+	   relevance of a snippet without scoring it */
+	guint *words_lengths;
+	guint *words_periods;
+	guint n_words;
+
+	/* The results: the entries which might be relevant and a bounded heap of the
+	   most relevant of them, which is sorted when the job is done */
+	GArray *candidates;
+	SnippetEntry *top_entries;
+	guint n_top_entries;
+	guint max_top_entries;
+} CompletionJob;
+
+
+static void run_completion_job (gpointer data,
+                                gpointer user_data);
+static void stop_listening     (SnippetsProvider *snippets_provider);
+
 /* IAnjutaProvider methods declaration */
 
 static void             snippets_provider_iface_init     (IAnjutaProviderIface* iface);
@@ -98,16 +178,59 @@ snippets_provider_init (SnippetsProvider *obj)
 	priv->request          = FALSE;
 	priv->listening        = FALSE;
 	priv->start_iter       = NULL;
-	priv->suggestions_list = NULL;
+	priv->suggestions_list   = NULL;
+	priv->proposals_snapshot = NULL;
+	priv->proposals_pool     = NULL;
+	priv->max_proposals    = DEFAULT_MAX_PROPOSALS;
+
+	priv->scoring          = SNIPPETS_PROVIDER_SCORING_RELEVANCE;
+
+	priv->completion_pool    = g_thread_pool_new (run_completion_job, NULL, 1, FALSE, NULL);
+	priv->debounce_source_id = 0;
+	priv->job_generation     = 0;
+	priv->job_cancellable    = NULL;
+	priv->pending_words      = NULL;
+	priv->pending_cursor     = NULL;
+
+	priv->candidates = g_array_new (FALSE, FALSE, sizeof (SnippetEntry));
+
+	priv->suggestions_valid      = FALSE;
+	priv->suggestions_words      = NULL;
+	priv->suggestions_language   = NULL;
+	priv->suggestions_snapshot   = NULL;
 
 	obj->anjuta_shell = NULL;
 
 }
 
+static void
+snippets_provider_finalize (GObject *obj)
+{
+	SnippetsProviderPrivate *priv = ANJUTA_SNIPPETS_PROVIDER_GET_PRIVATE (obj);
+
+	/* The running job holds a reference on the provider, so there is none left */
+	stop_listening (ANJUTA_SNIPPETS_PROVIDER (obj));
+	g_thread_pool_free (priv->completion_pool, TRUE, TRUE);
+	priv->completion_pool = NULL;
+
+	g_array_free (priv->candidates, TRUE);
+	priv->candidates = NULL;
+
+	g_list_foreach (priv->proposals_pool, (GFunc)g_free, NULL);
+	g_list_free (priv->proposals_pool);
+	priv->proposals_pool = NULL;
+
+	G_OBJECT_CLASS (snippets_provider_parent_class)->finalize (obj);
+}
+
 static void
 snippets_provider_class_init (SnippetsProviderClass *klass)
 {
+	GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
 	snippets_provider_parent_class = g_type_class_peek_parent (klass);
+	object_class->finalize = snippets_provider_finalize;
+
 	g_type_class_add_private (klass, sizeof (SnippetsProviderPrivate));	
 
 }
@@ -124,199 +247,224 @@ snippets_provider_iface_init (IAnjutaProviderIface* iface)
 
 /* Private methods */
 
+/* Scores the snippet with the scoring mode selected when the job was started */
 static gdouble
-get_relevance_for_word (const gchar *search_word,
-                        const gchar *key_word)
+get_candidate_relevance (CompletionJob *job,
+                         const SnippetsDBSnapshotEntry *snapshot_entry)
 {
-	gint i = 0, search_word_len = 0, key_word_len = 0;
-	gdouble relevance = 0.0, cur_relevance = 0.0;
-
-	search_word_len = strlen (search_word);
-	key_word_len    = strlen (key_word);
-
-	for (i = 0; i < key_word_len - search_word_len + 1; i ++)
+	if (job->scoring == SNIPPETS_PROVIDER_SCORING_FUZZY)
 	{
-		if (g_str_has_prefix (key_word + i, search_word))
-		{
-			cur_relevance = RELEVANCE (search_word_len, key_word_len);
-			if (i == 0)
-				cur_relevance *= START_MATCH_BONUS;
-
-			relevance += cur_relevance;
-		}
+		/* If the snippet lacks any typed character, nothing can match */
+		if (job->words_chars_mask & ~snapshot_entry->search_chars_mask)
+			return 0.0;
+
+		return snippets_search_get_relevance (snapshot_entry->search_trigger_key,
+		                                      snapshot_entry->search_name,
+		                                      snapshot_entry->search_keywords,
+		                                      job->words_list,
+		                                      snippets_search_get_fuzzy_word_relevance);
 	}
 
-	return relevance;
+	return snippets_search_get_relevance (snapshot_entry->search_trigger_key,
+	                                      snapshot_entry->search_name,
+	                                      snapshot_entry->search_keywords,
+	                                      job->words_list,
+	                                      snippets_search_get_word_relevance);
 }
 
-static gdouble
-get_relevance_for_snippet (AnjutaSnippet *snippet,
-                           GList *words_list)
+static gint
+compare_snippet_entries (const SnippetEntry *entry1,
+                         const SnippetEntry *entry2)
 {
-	gchar *cur_word = NULL, *name = NULL, *trigger = NULL, *cur_keyword = NULL;
-	gdouble relevance = 0.0, cur_relevance = 0.0, cur_keyword_relevance = 0.0;
-	GList *iter = NULL, *keywords = NULL, *keywords_down = NULL, *iter2 = NULL;
+	/* The more relevant entry comes first. Equally relevant entries are sorted by name. */
+	if (entry1->relevance > entry2->relevance)
+		return -1;
+	if (entry1->relevance < entry2->relevance)
+		return 1;
+
+	return g_strcmp0 (entry1->snapshot_entry->name,
+	                  entry2->snapshot_entry->name);
+}
 
-	/* Assertions */
-	g_return_val_if_fail (ANJUTA_IS_SNIPPET (snippet), 0.0);
+static gint
+snippets_relevance_sort_func (gconstpointer a,
+                              gconstpointer b)
+{
+	return compare_snippet_entries ((const SnippetEntry *)a,
+	                                (const SnippetEntry *)b);
+}
 
-	/* If the user hasn't typed anything we just consider all snippets relevant */
-	if (words_list == NULL)
-		return 1.0;
+/* Prepends a proposal for the entry to the suggestions list. The list node and
+   the proposal are taken from the pool if there is a cleared one. */
+static void
+prepend_proposal_for_entry (SnippetsProvider *snippets_provider,
+                            const SnippetEntry *entry,
+                            gboolean with_preview)
+{
+	SnippetsProviderPrivate *priv = NULL;
+	AnjutaSnippet *snippet = NULL;
+	GList *node = NULL;
+	ProposalSlot *slot = NULL;
 
-	/* Get the snippet data */
-	trigger  = g_utf8_strdown (snippet_get_trigger_key (snippet), -1);
-	name     = g_utf8_strdown (snippet_get_name (snippet), -1);
-	keywords = snippet_get_keywords_list (snippet);
-	for (iter = g_list_first (keywords); iter != NULL; iter = g_list_next (iter))
-	{
-		keywords_down = g_list_append (keywords_down, 
-		                               g_utf8_strdown ((gchar *)iter->data, -1));
-	}
-	g_list_free (keywords);
+	/* Assertions */
+	g_return_if_fail (ANJUTA_IS_SNIPPETS_PROVIDER (snippets_provider));
+	g_return_if_fail (entry != NULL);
+	priv = ANJUTA_SNIPPETS_PROVIDER_GET_PRIVATE (snippets_provider);
+	snippet = entry->snapshot_entry->snippet;
 
-	/* We iterate over all the words */
-	for (iter = g_list_first (words_list); iter != NULL; iter = g_list_next (iter))
+	/* Get a proposal object */
+	if (priv->proposals_pool != NULL)
 	{
-		cur_word = (gchar *)iter->data;
-
-		/* Check the trigger-key */
-		cur_relevance = get_relevance_for_word (cur_word, trigger);
-		cur_relevance *= TRIGGER_RELEVANCE;
-		relevance += cur_relevance;
+		node = priv->proposals_pool;
+		priv->proposals_pool = g_list_remove_link (priv->proposals_pool, node);
+	}
+	else
+		node = g_list_alloc ();
 
-		/* Check the name */
-		cur_relevance = get_relevance_for_word (cur_word, name);
-		cur_relevance *= NAME_RELEVANCE;
-		relevance += cur_relevance;
+	if (node->data == NULL)
+		node->data = g_new0 (ProposalSlot, 1);
+	slot = (ProposalSlot *)node->data;
 
-		/* Check each keyword */
-		cur_keyword_relevance = FIRST_KEYWORD_RELEVANCE;
-		for (iter2 = g_list_first (keywords_down); iter2 != NULL; iter2 = g_list_next (iter2))
-		{
-			/* If we have too many keywords */
-			if (cur_keyword_relevance < 0.0)
-				break;
+	/* Fill the markup field. It's owned by the snippet. */
+	slot->proposal.markup = (gchar *)snippet_get_proposal_markup (snippet);
 
-			cur_keyword = (gchar *)iter2->data;
+	/* Fill the info field. The preview is cached by the snippet. */
+	if (with_preview)
+		slot->proposal.info = (gchar *)snippet_get_preview (snippet);
 
-			cur_relevance = get_relevance_for_word (cur_word, cur_keyword);
-			cur_relevance *= cur_keyword_relevance;
-			relevance += cur_relevance;
-
-			cur_keyword_relevance -= KEYWORD_RELEVANCE_DEC; 
-		}
-	}
+	/* Fill the data field */
+	slot->entry         = *entry;
+	slot->proposal.data = &slot->entry;
 
-	return relevance;
+	priv->suggestions_list = g_list_concat (node, priv->suggestions_list);
 }
 
-static gint
-snippets_relevance_sort_func (gconstpointer a,
-                              gconstpointer b)
+static void
+free_words_list (GList *words_list)
 {
-	IAnjutaEditorAssistProposal *proposal1 = (IAnjutaEditorAssistProposal *)a,
-	                            *proposal2 = (IAnjutaEditorAssistProposal *)b;
-	SnippetEntry *entry1 = (SnippetEntry *)proposal1->data,
-	             *entry2 = (SnippetEntry *)proposal2->data;
-
-	if (entry1->relevance - entry2->relevance == 0.0)
-		return g_strcmp0 (snippet_get_name (entry1->snippet),
-		                  snippet_get_name (entry2->snippet));
+	GList *iter = NULL;
 
-	return (gint)(entry2->relevance - entry1->relevance);
+	for (iter = g_list_first (words_list); iter != NULL; iter = g_list_next (iter))
+		g_free (iter->data);
+	g_list_free (words_list);
 }
 
-static IAnjutaEditorAssistProposal*
-get_proposal_for_snippet (AnjutaSnippet *snippet,
-                          SnippetsDB *snippets_db,
-                          GList *words_list)
+static void
+clear_suggestions_list (SnippetsProvider *snippets_provider)
 {
-	IAnjutaEditorAssistProposal *proposal = NULL;
-	SnippetEntry *entry = NULL;
-	gchar *name_with_trigger = NULL;
+	SnippetsProviderPrivate *priv = NULL;
+	GList *iter = NULL, *last = NULL;
+	ProposalSlot *cur_slot = NULL;
 
 	/* Assertions */
-	g_return_val_if_fail (ANJUTA_IS_SNIPPET (snippet), NULL);
+	g_return_if_fail (ANJUTA_IS_SNIPPETS_PROVIDER (snippets_provider));
+	priv = ANJUTA_SNIPPETS_PROVIDER_GET_PRIVATE (snippets_provider);
 
-	/* Make a new proposal object */
-	proposal = g_new0 (IAnjutaEditorAssistProposal, 1);
-	entry = g_new0 (SnippetEntry, 1);
+	/* The proposals are kept in the pool. They don't own any of their fields. */
+	for (iter = g_list_first (priv->suggestions_list); iter != NULL; iter = g_list_next (iter))
+	{
+		cur_slot = (ProposalSlot *)iter->data;
 
-	/* Fill the markup field */
-	name_with_trigger = g_strconcat (snippet_get_name (snippet), " (<b>",
-	                                 snippet_get_trigger_key (snippet), "</b>)",
-	                                 NULL);
-	proposal->markup = name_with_trigger;
+		cur_slot->proposal.markup      = NULL;
+		cur_slot->proposal.info        = NULL;
+		cur_slot->entry.snapshot_entry = NULL;
+		last = iter;
+	}
 
-#if 0
-	/* Fill the info field */
-	proposal->info = snippet_get_default_content (snippet, G_OBJECT (snippets_db), "");
-#endif
+	if (last != NULL)
+	{
+		last->next = priv->proposals_pool;
+		if (priv->proposals_pool != NULL)
+			priv->proposals_pool->prev = last;
+		priv->proposals_pool = priv->suggestions_list;
+	}
+	priv->suggestions_list = NULL;
 
-	/* Fill the data field */
-	entry->snippet   = snippet;
-	entry->relevance = get_relevance_for_snippet (snippet, words_list);
-	proposal->data = entry;
+	if (priv->proposals_snapshot != NULL)
+		snippets_db_snapshot_unref (priv->proposals_snapshot);
+	priv->proposals_snapshot = NULL;
 
-	return proposal;
 }
 
 static void
-clear_suggestions_list (SnippetsProvider *snippets_provider)
+clear_candidates (SnippetsProvider *snippets_provider)
 {
 	SnippetsProviderPrivate *priv = NULL;
-	GList *iter = NULL;
-	IAnjutaEditorAssistProposal *cur_proposal = NULL;
 
 	/* Assertions */
 	g_return_if_fail (ANJUTA_IS_SNIPPETS_PROVIDER (snippets_provider));
 	priv = ANJUTA_SNIPPETS_PROVIDER_GET_PRIVATE (snippets_provider);
 
-	for (iter = g_list_first (priv->suggestions_list); iter != NULL; iter = g_list_next (iter))
-	{
-		cur_proposal = (IAnjutaEditorAssistProposal *)iter->data;
+	g_array_set_size (priv->candidates, 0);
 
-		g_free (cur_proposal->markup);
-		g_free (cur_proposal->data);
-		g_free (cur_proposal);		
-	}
-	g_list_free (priv->suggestions_list);
-	priv->suggestions_list = NULL;
+	/* The previous candidates can't be narrowed anymore */
+	free_words_list (priv->suggestions_words);
+	priv->suggestions_words    = NULL;
+	priv->suggestions_language = NULL;
+	priv->suggestions_valid    = FALSE;
+
+	if (priv->suggestions_snapshot != NULL)
+		snippets_db_snapshot_unref (priv->suggestions_snapshot);
+	priv->suggestions_snapshot = NULL;
 
 }
 
 static const gchar *
 get_current_editor_language (SnippetsProvider *snippets_provider)
 {
-
-	IAnjutaDocumentManager *docman = NULL;
-	IAnjutaDocument *doc = NULL;
-	IAnjutaLanguage *ilanguage = NULL;
+	SnippetsProviderPrivate *priv = NULL;
 
 	/* Assertions */
 	g_return_val_if_fail (ANJUTA_IS_SNIPPETS_PROVIDER (snippets_provider), NULL);
-	g_return_val_if_fail (ANJUTA_IS_SHELL (snippets_provider->anjuta_shell), NULL);
+	priv = ANJUTA_SNIPPETS_PROVIDER_GET_PRIVATE (snippets_provider);
+	g_return_val_if_fail (ANJUTA_IS_SNIPPETS_DB (priv->snippets_db), NULL);
+
+	/* The language is cached in the database when the current document changes */
+	return snippets_db_get_current_language (priv->snippets_db);
+}
+
+static void
+free_completion_job (CompletionJob *job)
+{
+	g_object_unref (job->snippets_provider);
+	g_object_unref (job->cancellable);
+
+	if (job->snapshot != NULL)
+		snippets_db_snapshot_unref (job->snapshot);
+	if (job->entries != NULL)
+		g_ptr_array_free (job->entries, TRUE);
+	if (job->candidates != NULL)
+		g_array_free (job->candidates, TRUE);
+
+	free_words_list (job->words_list);
+	g_free (job->top_entries);
+	g_free (job->words_lengths);
+	g_free (job->words_periods);
+
+	g_slice_free (CompletionJob, job);
+}
 
-	/* Get the document manager and assert it */
-	docman = anjuta_shell_get_interface (snippets_provider->anjuta_shell, 
-	                                     IAnjutaDocumentManager, 
-	                                     NULL);
-	g_return_val_if_fail (IANJUTA_IS_DOCUMENT_MANAGER (docman), NULL);
+/* Makes the pending and the running completion jobs stale */
+static void
+cancel_completion (SnippetsProvider *snippets_provider)
+{
+	SnippetsProviderPrivate *priv = NULL;
 
-	/* Get the language manager and assert it */
-	ilanguage = anjuta_shell_get_interface (snippets_provider->anjuta_shell,
-	                                        IAnjutaLanguage,
-	                                        NULL);
-	g_return_val_if_fail (IANJUTA_IS_LANGUAGE (ilanguage), NULL);
+	/* Assertions */
+	g_return_if_fail (ANJUTA_IS_SNIPPETS_PROVIDER (snippets_provider));
+	priv = ANJUTA_SNIPPETS_PROVIDER_GET_PRIVATE (snippets_provider);
 
-	/* Get the current editor and assert it */
-	doc = ianjuta_document_manager_get_current_document (docman, NULL);
-	g_return_val_if_fail (IANJUTA_IS_EDITOR (doc), NULL);
+	if (priv->debounce_source_id != 0)
+		g_source_remove (priv->debounce_source_id);
+	priv->debounce_source_id = 0;
 
-	return ianjuta_language_get_name_from_editor (ilanguage,
-	                                              IANJUTA_EDITOR_LANGUAGE (doc),
-	                                              NULL);
+	priv->job_generation ++;
+	if (priv->job_cancellable != NULL)
+	{
+		g_cancellable_cancel (priv->job_cancellable);
+		g_object_unref (priv->job_cancellable);
+	}
+	priv->job_cancellable = NULL;
 }
 
 static void
@@ -328,51 +476,508 @@ stop_listening (SnippetsProvider *snippets_provider)
 	g_return_if_fail (ANJUTA_IS_SNIPPETS_PROVIDER (snippets_provider));
 	priv = ANJUTA_SNIPPETS_PROVIDER_GET_PRIVATE (snippets_provider);
 
+	cancel_completion (snippets_provider);
+
 	if (IANJUTA_IS_ITERABLE (priv->start_iter))
 		g_object_unref (priv->start_iter);
 	priv->start_iter = NULL;
 
+	if (IANJUTA_IS_ITERABLE (priv->pending_cursor))
+		g_object_unref (priv->pending_cursor);
+	priv->pending_cursor = NULL;
+
+	free_words_list (priv->pending_words);
+	priv->pending_words = NULL;
+
 	priv->request   = FALSE;
 	priv->listening = FALSE;
 
 	clear_suggestions_list (snippets_provider);
+	clear_candidates (snippets_provider);
+
+}
+
+/* Checks if the snippets matching words_list are a subset of the ones that matched
+   the words the current candidates were found for. A snippet is relevant only if
+   all the words match it, so this holds if each old word is contained in one of
+   the new words, like when the last word is extended or a new word is added. It
+   holds for both scoring modes, as a substring of a subsequence is a subsequence. */
+static gboolean
+can_narrow_candidates (SnippetsProvider *snippets_provider,
+                       SnippetsDBSnapshot *snapshot,
+                       GList *words_list,
+                       const gchar *language)
+{
+	SnippetsProviderPrivate *priv = NULL;
+	GList *old_iter = NULL, *new_iter = NULL;
+	gboolean contained = FALSE;
+
+	/* Assertions */
+	g_return_val_if_fail (ANJUTA_IS_SNIPPETS_PROVIDER (snippets_provider), FALSE);
+	priv = ANJUTA_SNIPPETS_PROVIDER_GET_PRIVATE (snippets_provider);
+
+	if (!priv->suggestions_valid)
+		return FALSE;
+
+	/* The candidates point into the snapshot they were found in. If the snippets
+	   changed since, the snapshot is another one. The language index might also
+	   give other snippets. The languages are interned strings. */
+	if (priv->suggestions_snapshot != snapshot ||
+	    priv->suggestions_language != language)
+		return FALSE;
+
+	/* Each old word must be contained in a new word. An empty search matched all
+	   the snippets. */
+	for (old_iter = g_list_first (priv->suggestions_words); old_iter != NULL; old_iter = g_list_next (old_iter))
+	{
+		contained = FALSE;
+		for (new_iter = g_list_first (words_list); new_iter != NULL; new_iter = g_list_next (new_iter))
+		{
+			if (strstr ((gchar *)new_iter->data, (gchar *)old_iter->data) != NULL)
+			{
+				contained = TRUE;
+				break;
+			}
+		}
+
+		if (!contained)
+			return FALSE;
+	}
+
+	return TRUE;
+}
+
+/* Keeps the most relevant entries of the job in a binary heap which has the least
+   relevant of them at its root. Selecting them this way costs O(n log k), instead
+   of sorting all the candidates. */
+static void
+push_entry_to_bounded_heap (CompletionJob *job,
+                            const SnippetEntry *entry)
+{
+	SnippetEntry *heap = job->top_entries;
+	guint node = 0, parent = 0, child = 0;
+
+	if (job->n_top_entries < job->max_top_entries)
+	{
+		/* Sift the new entry up, while it's less relevant than its parent */
+		node = job->n_top_entries ++;
+		while (node > 0)
+		{
+			parent = (node - 1) / 2;
+			if (compare_snippet_entries (&heap[parent], entry) >= 0)
+				break;
+
+			heap[node] = heap[parent];
+			node = parent;
+		}
+		heap[node] = *entry;
+
+		return;
+	}
+
+	/* The heap is full, so the entry replaces the root only if it's more relevant */
+	if (compare_snippet_entries (entry, &heap[0]) >= 0)
+		return;
+
+	/* Sift the new entry down, while a child is less relevant than it */
+	node = 0;
+	while ((child = 2 * node + 1) < job->n_top_entries)
+	{
+		if (child + 1 < job->n_top_entries &&
+		    compare_snippet_entries (&heap[child + 1], &heap[child]) > 0)
+			child ++;
+
+		if (compare_snippet_entries (entry, &heap[child]) >= 0)
+			break;
+
+		heap[node] = heap[child];
+		node = child;
+	}
+	heap[node] = *entry;
+}
+
+/* The smallest period of the word, computed with the KMP failure function. Two
+   occurrences of the word in a key word are at least this far apart. */
+static guint
+get_word_period (const gchar *word,
+                 guint word_len)
+{
+	guint *failure = NULL, i = 0, k = 0, period = 0;
+
+	if (word_len == 0)
+		return 1;
+
+	failure = g_new (guint, word_len);
+	failure[0] = 0;
+	for (i = 1; i < word_len; i ++)
+	{
+		while (k > 0 && word[i] != word[k])
+			k = failure[k - 1];
+		if (word[i] == word[k])
+			k ++;
+		failure[i] = k;
+	}
+
+	period = word_len - failure[word_len - 1];
+	g_free (failure);
+
+	return period;
+}
+
+/* The most snippets_search_get_word_relevance can give for a word with the given length and
+   period in a key word of key_len bytes. The word occurs at most once per period
+   and the start bonus counts at most once. */
+static gdouble
+get_relevance_bound_for_word (guint word_len,
+                              guint word_period,
+                              guint key_len)
+{
+	guint max_count = 0;
+
+	if (word_len == 0 || word_len > key_len)
+		return 0.0;
+
+	max_count = (key_len - word_len) / word_period + 1;
+
+	return (max_count + START_MATCH_BONUS - 1.0) * RELEVANCE (word_len, key_len);
+}
+
+/* The most snippets_search_get_relevance can give for the entry, computed only from
+   the lengths of its search fields, with the same weights. */
+static gdouble
+get_relevance_bound_for_entry (CompletionJob *job,
+                               const SnippetsDBSnapshotEntry *snapshot_entry)
+{
+	const guint *lengths = snapshot_entry->search_lengths;
+	guint n_lengths = snapshot_entry->n_search_lengths, i = 0, k = 0;
+	gdouble bound = 0.0, keyword_relevance = 0.0;
+
+	for (i = 0; i < job->n_words; i ++)
+	{
+		bound += TRIGGER_RELEVANCE *
+		         get_relevance_bound_for_word (job->words_lengths[i], job->words_periods[i], lengths[0]);
+		bound += NAME_RELEVANCE *
+		         get_relevance_bound_for_word (job->words_lengths[i], job->words_periods[i], lengths[1]);
+
+		keyword_relevance = FIRST_KEYWORD_RELEVANCE;
+		for (k = 2; k < n_lengths && keyword_relevance >= 0.0; k ++)
+		{
+			bound += keyword_relevance *
+			         get_relevance_bound_for_word (job->words_lengths[i], job->words_periods[i], lengths[k]);
+			keyword_relevance -= KEYWORD_RELEVANCE_DEC;
+		}
+	}
+
+	return bound * RELEVANCE_BOUND_SLACK;
+}
+
+static void
+add_candidate_for_entry (CompletionJob *job,
+                         const SnippetsDBSnapshotEntry *snapshot_entry)
+{
+	SnippetEntry cur_entry;
+
+	cur_entry.snapshot_entry = snapshot_entry;
+
+	/* If the snippet can't beat the least relevant of the top entries, we don't
+	   score it. It might still match, so it's kept as a candidate for narrowing,
+	   which scores all the candidates again. The bound is only known for the
+	   substring scoring. */
+	if (job->n_top_entries == job->max_top_entries &&
+	    job->n_words > 0 &&
+	    job->scoring == SNIPPETS_PROVIDER_SCORING_RELEVANCE &&
+	    get_relevance_bound_for_entry (job, snapshot_entry) < job->top_entries[0].relevance)
+	{
+		cur_entry.relevance = 0.0;
+		g_array_append_val (job->candidates, cur_entry);
+		return;
+	}
+
+	/* If the snippet isn't relevant for the typed text, we neglect it */
+	cur_entry.relevance = get_candidate_relevance (job, snapshot_entry);
+	if (cur_entry.relevance == 0.0)
+		return;
+
+	g_array_append_val (job->candidates, cur_entry);
+	push_entry_to_bounded_heap (job, &cur_entry);
+}
+
+static void
+build_proposals (CompletionJob *job)
+{
+	SnippetsProvider *snippets_provider = job->snippets_provider;
+	SnippetsProviderPrivate *priv = ANJUTA_SNIPPETS_PROVIDER_GET_PRIVATE (snippets_provider);
+	guint i = 0;
+
+	/* The job's candidates become the current ones, which can be narrowed */
+	clear_suggestions_list (snippets_provider);
+	clear_candidates (snippets_provider);
+
+	g_array_free (priv->candidates, TRUE);
+	priv->candidates = job->candidates;
+	job->candidates  = NULL;
+
+	priv->suggestions_valid    = TRUE;
+	priv->suggestions_words    = job->words_list;
+	priv->suggestions_language = job->language;
+	priv->suggestions_snapshot = snippets_db_snapshot_ref (job->snapshot);
+	job->words_list = NULL;
+
+	/* Only the proposals on the first page get a preview, so the ones the user
+	   has to scroll to don't slow down the typing */
+	priv->proposals_snapshot = snippets_db_snapshot_ref (job->snapshot);
+	for (i = job->n_top_entries; i > 0; i --)
+		prepend_proposal_for_entry (snippets_provider,
+		                            &job->top_entries[i - 1],
+		                            i - 1 < PREVIEW_PAGE_SIZE);
+}
+
+static gboolean
+on_completion_job_done (gpointer data)
+{
+	CompletionJob *job = (CompletionJob *)data;
+	SnippetsProvider *snippets_provider = job->snippets_provider;
+	SnippetsProviderPrivate *priv = ANJUTA_SNIPPETS_PROVIDER_GET_PRIVATE (snippets_provider);
+
+	/* A newer job was started, the user stopped the completion, or the scoring
+	   mode or the snippets changed meanwhile, so the results are stale */
+	if (job->generation != priv->job_generation ||
+	    g_cancellable_is_cancelled (job->cancellable) ||
+	    !priv->listening ||
+	    job->scoring != priv->scoring ||
+	    job->snapshot->generation != snippets_db_get_generation (priv->snippets_db))
+	{
+		free_completion_job (job);
+		return FALSE;
+	}
+
+	g_object_unref (priv->job_cancellable);
+	priv->job_cancellable = NULL;
+
+	build_proposals (job);
+	free_completion_job (job);
+
+	/* Clear the previous indicator */
+	if (IANJUTA_IS_INDICABLE (priv->editor_assist))
+		ianjuta_indicable_clear (IANJUTA_INDICABLE (priv->editor_assist), NULL);
 
+	if (priv->suggestions_list == NULL)
+	{
+		stop_listening (snippets_provider);
+		ianjuta_editor_assist_proposals (priv->editor_assist,
+		                                 IANJUTA_PROVIDER (snippets_provider),
+		                                 NULL, TRUE, NULL);
+		return FALSE;
+	}
+
+	/* Highlight the search string */
+	if (IANJUTA_IS_INDICABLE (priv->editor_assist))
+	{
+		ianjuta_indicable_set (IANJUTA_INDICABLE (priv->editor_assist),
+		                       priv->start_iter,
+		                       priv->pending_cursor,
+		                       IANJUTA_INDICABLE_IMPORTANT,
+		                       NULL);
+	}
+
+	ianjuta_editor_assist_proposals (priv->editor_assist,
+	                                 IANJUTA_PROVIDER (snippets_provider),
+	                                 priv->suggestions_list,
+	                                 TRUE, NULL);
+
+	return FALSE;
 }
 
+/* Runs in the completion thread. It only reads the job and the frozen search
+   fields of the snapshot entries, never the snippets themselves. The results are
+   handed back to the main loop in an idle callback. */
+static void
+run_completion_job (gpointer data,
+                    gpointer user_data)
+{
+	CompletionJob *job = (CompletionJob *)data;
+	GList *iter = NULL;
+	guint i = 0;
+
+	job->candidates = g_array_new (FALSE, FALSE, sizeof (SnippetEntry));
 
+	/* A maximum of 0 means there is no limit */
+	job->max_top_entries = (job->entries != NULL) ? job->entries->len : job->snapshot->n_entries;
+	if (job->max_proposals > 0 && job->max_proposals < job->max_top_entries)
+		job->max_top_entries = job->max_proposals;
+	job->top_entries = g_new (SnippetEntry, job->max_top_entries);
+
+	job->n_words       = g_list_length (job->words_list);
+	job->words_lengths = g_new (guint, job->n_words);
+	job->words_periods = g_new (guint, job->n_words);
+	for (iter = g_list_first (job->words_list), i = 0; iter != NULL; iter = g_list_next (iter), i ++)
+	{
+		job->words_lengths[i] = strlen ((const gchar *)iter->data);
+		job->words_periods[i] = get_word_period ((const gchar *)iter->data, job->words_lengths[i]);
+	}
+
+	if (job->entries != NULL)
+	{
+		for (i = 0; i < job->entries->len; i ++)
+		{
+			if (i % COMPLETION_CANCEL_CHECK_INTERVAL == 0 &&
+			    g_cancellable_is_cancelled (job->cancellable))
+				break;
+
+			add_candidate_for_entry (job, g_ptr_array_index (job->entries, i));
+		}
+	}
+	else
+	{
+		for (i = 0; i < job->snapshot->n_entries; i ++)
+		{
+			if (i % COMPLETION_CANCEL_CHECK_INTERVAL == 0 &&
+			    g_cancellable_is_cancelled (job->cancellable))
+				break;
+
+			add_candidate_for_entry (job, &job->snapshot->entries[i]);
+		}
+	}
+
+	if (!g_cancellable_is_cancelled (job->cancellable))
+		qsort (job->top_entries, job->n_top_entries, sizeof (SnippetEntry),
+		       snippets_relevance_sort_func);
+
+	g_idle_add (on_completion_job_done, job);
+}
+
+/* Maps the snippets given by the database indexes to their entries in the snapshot */
+static GPtrArray *
+get_entries_for_snippets (SnippetsDBSnapshot *snapshot,
+                          AnjutaSnippet **snippets,
+                          guint n_snippets)
+{
+	GPtrArray *entries = NULL;
+	const SnippetsDBSnapshotEntry *cur_entry = NULL;
+	guint i = 0;
+
+	entries = g_ptr_array_sized_new (n_snippets);
+	for (i = 0; i < n_snippets; i ++)
+	{
+		cur_entry = snippets_db_snapshot_get_entry (snapshot, snippets[i]);
+		if (cur_entry != NULL)
+			g_ptr_array_add (entries, (gpointer)cur_entry);
+	}
+
+	return entries;
+}
+
+/* Builds a job for the words typed at the last populate call and passes it to the
+   completion thread. The snapshot entries to score are chosen here, from the main
+   loop, as the database indexes hold the live snippets. */
 static void
-build_suggestions_list (SnippetsProvider *snippets_provider,
-                        IAnjutaIterable *cur_cursor_position)
+start_completion_job (SnippetsProvider *snippets_provider)
 {
 	SnippetsProviderPrivate *priv = NULL;
-	GtkTreeIter iter, iter2;
-	GObject *cur_object = NULL;
-	IAnjutaEditorAssistProposal *cur_proposal = NULL;
-	SnippetEntry *cur_entry = NULL;
-	gchar *search_string = NULL, **words = NULL;
-	gboolean show_all_languages = FALSE;
-	const gchar *language = NULL;
-	gint i = 0;
-	GList *words_list = NULL, *l_iter = NULL;
+	CompletionJob *job = NULL;
+	AnjutaSnippet **language_snippets = NULL;
+	GPtrArray *word_snippets = NULL;
+	guint n_language_snippets = 0, i = 0;
+	GList *l_iter = NULL;
+	const gchar *search_chars = NULL;
 
 	/* Assertions */
 	g_return_if_fail (ANJUTA_IS_SNIPPETS_PROVIDER (snippets_provider));
-	g_return_if_fail (IANJUTA_IS_ITERABLE (cur_cursor_position));
 	priv = ANJUTA_SNIPPETS_PROVIDER_GET_PRIVATE (snippets_provider);
-	g_return_if_fail (IANJUTA_IS_ITERABLE (cur_cursor_position));
 	g_return_if_fail (ANJUTA_IS_SNIPPETS_DB (priv->snippets_db));
-	g_return_if_fail (priv->suggestions_list == NULL);
 
-	if (ianjuta_iterable_diff (priv->start_iter, cur_cursor_position, NULL) < 0)
+	/* Make the previous job stale */
+	cancel_completion (snippets_provider);
+
+	job = g_slice_new0 (CompletionJob);
+	job->snippets_provider = g_object_ref (snippets_provider);
+	job->generation        = priv->job_generation;
+	job->cancellable       = g_cancellable_new ();
+	priv->job_cancellable  = g_object_ref (job->cancellable);
+
+	/* The completion thread only reads the snapshot of the current generation */
+	job->snapshot      = snippets_db_get_snapshot (priv->snippets_db);
+	job->language      = get_current_editor_language (snippets_provider);
+	job->scoring       = priv->scoring;
+	job->max_proposals = priv->max_proposals;
+	job->words_list    = priv->pending_words;
+	priv->pending_words = NULL;
+
+	/* Get the mask of the typed characters, used to reject snippets quickly */
+	for (l_iter = g_list_first (job->words_list); l_iter != NULL; l_iter = g_list_next (l_iter))
+		for (search_chars = (const gchar *)l_iter->data; *search_chars != 0; search_chars ++)
+			job->words_chars_mask |= SNIPPET_CHAR_MASK_BIT (*search_chars);
+
+	/* If the user just continued typing, the previous candidates are the only
+	   ones left, so we just rescore them */
+	if (can_narrow_candidates (snippets_provider, job->snapshot, job->words_list, job->language))
 	{
-		stop_listening (snippets_provider);
-		return;
+		job->entries = g_ptr_array_sized_new (priv->candidates->len);
+		for (i = 0; i < priv->candidates->len; i ++)
+			g_ptr_array_add (job->entries,
+			                 (gpointer)g_array_index (priv->candidates, SnippetEntry, i).snapshot_entry);
 	}
+	else
+	/* The trigram index gives the snippets which might contain all the words. The
+	   fuzzy matches aren't contiguous, so it can't be used for them. */
+	if (priv->scoring == SNIPPETS_PROVIDER_SCORING_RELEVANCE)
+	{
+		word_snippets = snippets_db_get_snippets_containing_words (priv->snippets_db,
+		                                                           job->language,
+		                                                           job->words_list);
+		if (word_snippets != NULL)
+		{
+			job->entries = get_entries_for_snippets (job->snapshot,
+			                                         (AnjutaSnippet **)word_snippets->pdata,
+			                                         word_snippets->len);
+			g_ptr_array_free (word_snippets, TRUE);
+		}
+	}
+
+	/* If we know the language, we only look at its snippets using the language index.
+	   Otherwise, the completion thread looks at all the entries in the snapshot. */
+	if (job->entries == NULL && job->language != NULL)
+	{
+		language_snippets = snippets_db_get_snippets_for_language (priv->snippets_db,
+		                                                           job->language,
+		                                                           NULL,
+		                                                           &n_language_snippets);
+		job->entries = get_entries_for_snippets (job->snapshot,
+		                                         language_snippets,
+		                                         n_language_snippets);
+	}
+
+	g_thread_pool_push (priv->completion_pool, job, NULL);
+}
+
+static gboolean
+on_debounce_timeout (gpointer data)
+{
+	SnippetsProvider *snippets_provider = ANJUTA_SNIPPETS_PROVIDER (data);
+	SnippetsProviderPrivate *priv = ANJUTA_SNIPPETS_PROVIDER_GET_PRIVATE (snippets_provider);
+
+	priv->debounce_source_id = 0;
+	start_completion_job (snippets_provider);
+
+	return FALSE;
+}
 
-	/* Get the language of the current editor */
-	language = get_current_editor_language (snippets_provider);
-	if (!language)
-		show_all_languages = TRUE;
+/* Reads the words typed between the start iter and the cursor. The completion
+   job for them is started once the user pauses typing, so a burst of keystrokes
+   costs a single search. */
+static void
+schedule_completion (SnippetsProvider *snippets_provider,
+                     IAnjutaIterable *cur_cursor_position)
+{
+	SnippetsProviderPrivate *priv = NULL;
+	gchar *search_string = NULL, **words = NULL;
+	gint i = 0;
+	GList *words_list = NULL;
+
+	/* Assertions */
+	g_return_if_fail (ANJUTA_IS_SNIPPETS_PROVIDER (snippets_provider));
+	g_return_if_fail (IANJUTA_IS_ITERABLE (cur_cursor_position));
+	priv = ANJUTA_SNIPPETS_PROVIDER_GET_PRIVATE (snippets_provider);
 
 	/* Get the current searching string */
 	search_string = ianjuta_editor_get_text (IANJUTA_EDITOR (priv->editor_assist),
@@ -393,62 +998,20 @@ build_suggestions_list (SnippetsProvider *snippets_provider,
 		i ++;
 	}
 	g_strfreev (words);
+	g_free (search_string);
 
-	if (!gtk_tree_model_get_iter_first (GTK_TREE_MODEL (priv->snippets_db), &iter))
-		return;
-
-	do
-	{
-		/* Get the children for the current snippets group */
-		if (!gtk_tree_model_iter_children (GTK_TREE_MODEL (priv->snippets_db), &iter2, &iter))
-			continue;
-
-		/* Iterate over the snippets */
-		do
-		{
-			gtk_tree_model_get (GTK_TREE_MODEL (priv->snippets_db), &iter2,
-			                    SNIPPETS_DB_MODEL_COL_CUR_OBJECT, &cur_object,
-			                    -1);
-			g_object_unref (cur_object);
-
-			if (!ANJUTA_IS_SNIPPET (cur_object))
-				continue;
-
-			/* If the current snippet isn't meant for the current editor language, we ignore it */
-			if (!show_all_languages && !snippet_has_language (ANJUTA_SNIPPET (cur_object), language))
-				continue;
-			
-			/* Build a proposal for the current snippet based on the words the user typed */
-			cur_proposal = get_proposal_for_snippet (ANJUTA_SNIPPET (cur_object),
-			                                         priv->snippets_db,
-			                                         words_list);
-
-			/* If the snippet isn't relevant for the typed text, we neglect this proposal */
-			cur_entry = (SnippetEntry *)cur_proposal->data;
-			if (cur_entry->relevance == 0.0)
-			{
-				g_free (cur_entry);
-				g_free (cur_proposal->markup);
-				g_free (cur_proposal);
-
-				continue;
-			}
-
-			/* We add the proposal to the suggestions list */
-			priv->suggestions_list = g_list_insert_sorted (priv->suggestions_list,
-			                                               cur_proposal,
-			                                               snippets_relevance_sort_func);
-
-		} while (gtk_tree_model_iter_next (GTK_TREE_MODEL (priv->snippets_db), &iter2));
+	free_words_list (priv->pending_words);
+	priv->pending_words = words_list;
 
-	} while (gtk_tree_model_iter_next (GTK_TREE_MODEL (priv->snippets_db), &iter));
+	if (IANJUTA_IS_ITERABLE (priv->pending_cursor))
+		g_object_unref (priv->pending_cursor);
+	priv->pending_cursor = ianjuta_iterable_clone (cur_cursor_position, NULL);
 
-	/* Free the data */
-	g_free (search_string);
-	for (l_iter = g_list_first (words_list); l_iter != NULL; l_iter = g_list_next (l_iter))
-		g_free (l_iter->data);
-	g_list_free (words_list);
-	
+	/* The running job is stale already, and the timeout starts over */
+	cancel_completion (snippets_provider);
+	priv->debounce_source_id = g_timeout_add (COMPLETION_DEBOUNCE_MS,
+	                                          on_debounce_timeout,
+	                                          snippets_provider);
 }
 
 static gchar
@@ -606,6 +1169,90 @@ snippets_provider_request (SnippetsProvider *snippets_provider)
 }
 
 
+/**
+ * snippets_provider_set_max_proposals:
+ * @snippets_provider: A #SnippetsProvider object.
+ * @max_proposals: The maximum number of proposals shown, or 0 for no limit.
+ *
+ * Sets how many of the most relevant snippets are proposed to the editor assist.
+ */
+void
+snippets_provider_set_max_proposals (SnippetsProvider *snippets_provider,
+                                     guint max_proposals)
+{
+	SnippetsProviderPrivate *priv = NULL;
+
+	/* Assertions */
+	g_return_if_fail (ANJUTA_IS_SNIPPETS_PROVIDER (snippets_provider));
+	priv = ANJUTA_SNIPPETS_PROVIDER_GET_PRIVATE (snippets_provider);
+
+	priv->max_proposals = max_proposals;
+}
+
+/**
+ * snippets_provider_set_scoring:
+ * @snippets_provider: A #SnippetsProvider object.
+ * @scoring: The way the snippets are matched against the typed text.
+ *
+ * Selects between the substring #SNIPPETS_PROVIDER_SCORING_RELEVANCE scoring, which
+ * is the default, and the #SNIPPETS_PROVIDER_SCORING_FUZZY subsequence scoring.
+ */
+void
+snippets_provider_set_scoring (SnippetsProvider *snippets_provider,
+                               SnippetsProviderScoring scoring)
+{
+	SnippetsProviderPrivate *priv = NULL;
+
+	/* Assertions */
+	g_return_if_fail (ANJUTA_IS_SNIPPETS_PROVIDER (snippets_provider));
+	priv = ANJUTA_SNIPPETS_PROVIDER_GET_PRIVATE (snippets_provider);
+
+	if (priv->scoring == scoring)
+		return;
+
+	/* The current candidates were scored the other way */
+	priv->scoring = scoring;
+	clear_candidates (snippets_provider);
+}
+
+/**
+ * snippets_provider_get_scoring:
+ * @snippets_provider: A #SnippetsProvider object.
+ *
+ * Returns: The way the snippets are matched against the typed text.
+ */
+SnippetsProviderScoring
+snippets_provider_get_scoring (SnippetsProvider *snippets_provider)
+{
+	SnippetsProviderPrivate *priv = NULL;
+
+	/* Assertions */
+	g_return_val_if_fail (ANJUTA_IS_SNIPPETS_PROVIDER (snippets_provider),
+	                      SNIPPETS_PROVIDER_SCORING_RELEVANCE);
+	priv = ANJUTA_SNIPPETS_PROVIDER_GET_PRIVATE (snippets_provider);
+
+	return priv->scoring;
+}
+
+/**
+ * snippets_provider_get_max_proposals:
+ * @snippets_provider: A #SnippetsProvider object.
+ *
+ * Returns: The maximum number of proposals shown, or 0 if there is no limit.
+ */
+guint
+snippets_provider_get_max_proposals (SnippetsProvider *snippets_provider)
+{
+	SnippetsProviderPrivate *priv = NULL;
+
+	/* Assertions */
+	g_return_val_if_fail (ANJUTA_IS_SNIPPETS_PROVIDER (snippets_provider), 0);
+	priv = ANJUTA_SNIPPETS_PROVIDER_GET_PRIVATE (snippets_provider);
+
+	return priv->max_proposals;
+}
+
+
 /* IAnjutaProvider methods declarations */
 
 static void
@@ -641,36 +1288,22 @@ snippets_provider_populate (IAnjutaProvider *self,
 		   separator. */
 		priv->start_iter = ianjuta_iterable_clone (cursor, NULL);
 		priv->request = FALSE;
-	}
-
-	clear_suggestions_list (snippets_provider);
-	build_suggestions_list (snippets_provider, cursor);
 
-	/* Clear the previous indicator */
-	if (IANJUTA_IS_INDICABLE (priv->editor_assist))
-		ianjuta_indicable_clear (IANJUTA_INDICABLE (priv->editor_assist), NULL);
+		/* The search starts over from the new starting iter */
+		clear_candidates (snippets_provider);
+	}
 
-	if (priv->suggestions_list == NULL)
+	/* If the cursor moved before the starting iter, we stop */
+	if (ianjuta_iterable_diff (priv->start_iter, cursor, NULL) < 0)
 	{
 		stop_listening (snippets_provider);
 		ianjuta_editor_assist_proposals (priv->editor_assist, self, NULL, TRUE, NULL);
 		return;
 	}
 
-	/* Highlight the search string */
-	if (IANJUTA_IS_INDICABLE (priv->editor_assist))
-	{
-		ianjuta_indicable_set (IANJUTA_INDICABLE (priv->editor_assist),
-		                       priv->start_iter,
-		                       cursor,
-		                       IANJUTA_INDICABLE_IMPORTANT,
-		                       NULL);
-	}
-
-	ianjuta_editor_assist_proposals (priv->editor_assist,
-	                                 self,
-	                                 priv->suggestions_list,
-	                                 TRUE, NULL);
+	/* The proposals are given to the editor assist when the completion job is
+	   done, in on_completion_job_done */
+	schedule_completion (snippets_provider, cursor);
 
 }
 
@@ -704,7 +1337,7 @@ snippets_provider_activate (IAnjutaProvider *self,
 	g_return_if_fail (IANJUTA_IS_EDITOR (priv->editor_assist));
 
 	/* Get the Snippet and assert it */
-	snippet = ((SnippetEntry *)data)->snippet;
+	snippet = ((SnippetEntry *)data)->snapshot_entry->snippet;
 	g_return_if_fail (ANJUTA_IS_SNIPPET (snippet));
 
 	/* Erase the text */
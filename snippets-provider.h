@@ -35,6 +35,21 @@ typedef struct _SnippetsProvider SnippetsProvider;
 typedef struct _SnippetsProviderPrivate SnippetsProviderPrivate;
 typedef struct _SnippetsProviderClass SnippetsProviderClass;
 
+/**
+ * SnippetsProviderScoring:
+ * @SNIPPETS_PROVIDER_SCORING_RELEVANCE: The typed words must be substrings of the
+ *                                       trigger-key, name or keywords.
+ * @SNIPPETS_PROVIDER_SCORING_FUZZY: The typed words must be subsequences of them, like
+ *                                   "fori" for "for loop with index".
+ *
+ * The ways the snippets provider can match the snippets against the typed text.
+ */
+typedef enum
+{
+	SNIPPETS_PROVIDER_SCORING_RELEVANCE = 0,
+	SNIPPETS_PROVIDER_SCORING_FUZZY
+} SnippetsProviderScoring;
+
 #define ANJUTA_TYPE_SNIPPETS_PROVIDER            (snippets_provider_get_type ())
 #define ANJUTA_SNIPPETS_PROVIDER(obj)            (G_TYPE_CHECK_INSTANCE_CAST ((obj), ANJUTA_TYPE_SNIPPETS_PROVIDER, SnippetsProvider))
 #define ANJUTA_SNIPPETS_PROVIDER_CLASS(klass)    (G_TYPE_CHECK_CLASS_CAST ((klass), ANJUTA_TYPE_SNIPPETS_PROVIDER, SnippetsProviderClass))
@@ -63,6 +78,12 @@ void                 snippets_provider_load     (SnippetsProvider *snippets_prov
                                                  IAnjutaEditorAssist *editor_assist);
 void                 snippets_provider_unload   (SnippetsProvider *snippets_provider);
 void                 snippets_provider_request  (SnippetsProvider *snippets_provider);
+void                 snippets_provider_set_max_proposals (SnippetsProvider *snippets_provider,
+                                                          guint max_proposals);
+guint                snippets_provider_get_max_proposals (SnippetsProvider *snippets_provider);
+void                 snippets_provider_set_scoring (SnippetsProvider *snippets_provider,
+                                                    SnippetsProviderScoring scoring);
+SnippetsProviderScoring snippets_provider_get_scoring (SnippetsProvider *snippets_provider);
 
 G_END_DECLS
 
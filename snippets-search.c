@@ -0,0 +1,328 @@
+/* -*- Mode: C; indent-tabs-mode: t; c-basic-offset: 4; tab-width: 4 -*- */
+/*
+    snippets-search.c
+    Copyright (C) Dragos Dena 2010
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, 
+	Boston, MA  02110-1301  USA
+*/
+
+#include <string.h>
+#include "snippets-search.h"
+#ifdef SNIPPETS_SEARCH_HAVE_X86_SIMD
+#include <immintrin.h>
+#endif
+
+#define FUZZY_SCORE_MATCH             16
+#define FUZZY_BONUS_BOUNDARY          8
+#define FUZZY_BONUS_CONSECUTIVE       4
+#define FUZZY_BONUS_FIRST_CHAR_FACTOR 2
+#define FUZZY_PENALTY_GAP_START       3
+#define FUZZY_PENALTY_GAP_EXTENSION   1
+
+#define IS_WORD_BOUNDARY(c)      (!g_ascii_isalnum (c))
+
+
+/**
+ * snippets_search_count_occurrences_scalar:
+ * @haystack: The searched text.
+ * @haystack_len: The length of @haystack.
+ * @needle: The searched word. Must be non-empty.
+ * @needle_len: The length of @needle, at most @haystack_len.
+ *
+ * The plain kernel, which the vectorized ones must always agree with.
+ *
+ * Returns: The number of occurrences of @needle in @haystack, overlapping ones included.
+ **/
+guint
+snippets_search_count_occurrences_scalar (const gchar *haystack,
+                                          gsize haystack_len,
+                                          const gchar *needle,
+                                          gsize needle_len)
+{
+	gsize i = 0;
+	guint count = 0;
+
+	for (i = 0; i + needle_len <= haystack_len; i ++)
+	{
+		if (haystack[i] == needle[0] && !memcmp (haystack + i, needle, needle_len))
+			count ++;
+	}
+
+	return count;
+}
+
+#ifdef SNIPPETS_SEARCH_HAVE_X86_SIMD
+
+/* The vectorized kernel compares the first and the last byte of the needle with
+   a block of consecutive offsets at once, and only checks the middle of the needle
+   at the offsets where both match. The offsets left at the end, and the keys too
+   short for a single block, are counted by the scalar kernel.
+
+   There is no AVX2 kernel: most keys are shorter than its 32 bytes blocks, and
+   bench-snippets-search showed it no faster than SSE2 on the longer ones. */
+
+/**
+ * snippets_search_count_occurrences_sse2:
+ *
+ * Like snippets_search_count_occurrences_scalar(), 16 offsets at a time.
+ **/
+__attribute__ ((target ("sse2")))
+guint
+snippets_search_count_occurrences_sse2 (const gchar *haystack,
+                                        gsize haystack_len,
+                                        const gchar *needle,
+                                        gsize needle_len)
+{
+	__m128i first, last, block_first, block_last;
+	guint32 mask = 0;
+	gsize i = 0;
+	guint count = 0, bit = 0;
+
+	if (haystack_len < needle_len - 1 + 16)
+		return snippets_search_count_occurrences_scalar (haystack, haystack_len, needle, needle_len);
+
+	first = _mm_set1_epi8 (needle[0]);
+	last  = _mm_set1_epi8 (needle[needle_len - 1]);
+
+	for (i = 0; i + needle_len - 1 + 16 <= haystack_len; i += 16)
+	{
+		block_first = _mm_loadu_si128 ((const __m128i *)(haystack + i));
+		block_last  = _mm_loadu_si128 ((const __m128i *)(haystack + i + needle_len - 1));
+
+		mask = (guint32)_mm_movemask_epi8 (_mm_and_si128 (_mm_cmpeq_epi8 (first, block_first),
+		                                                  _mm_cmpeq_epi8 (last, block_last)));
+		while (mask != 0)
+		{
+			bit = __builtin_ctz (mask);
+			if (needle_len <= 2 || !memcmp (haystack + i + bit + 1, needle + 1, needle_len - 2))
+				count ++;
+			mask &= mask - 1;
+		}
+	}
+
+	return count + snippets_search_count_occurrences_scalar (haystack + i, haystack_len - i,
+	                                                         needle, needle_len);
+}
+
+#endif /* SNIPPETS_SEARCH_HAVE_X86_SIMD */
+
+static SnippetsCountOccurrencesFunc
+select_count_occurrences_func (void)
+{
+#ifdef SNIPPETS_SEARCH_HAVE_X86_SIMD
+	__builtin_cpu_init ();
+	if (__builtin_cpu_supports ("sse2"))
+		return snippets_search_count_occurrences_sse2;
+#endif
+
+	return snippets_search_count_occurrences_scalar;
+}
+
+/**
+ * snippets_search_get_count_occurrences:
+ *
+ * Picks the fastest kernel the CPU supports, the first time it's called.
+ *
+ * Returns: The kernel to be used for counting occurrences.
+ **/
+SnippetsCountOccurrencesFunc
+snippets_search_get_count_occurrences (void)
+{
+	static gsize count_occurrences = 0;
+
+	if (g_once_init_enter (&count_occurrences))
+		g_once_init_leave (&count_occurrences, (gsize)select_count_occurrences_func ());
+
+	return (SnippetsCountOccurrencesFunc)count_occurrences;
+}
+
+/**
+ * snippets_search_get_word_relevance:
+ * @search_word: A lower-cased word typed by the user.
+ * @key_word: A lower-cased word of the snippet.
+ *
+ * Each occurrence of @search_word in @key_word adds the same RELEVANCE, multiplied
+ * by START_MATCH_BONUS for the one at the start.
+ *
+ * Returns: The relevance, 0 if @search_word isn't a substring of @key_word.
+ **/
+gdouble
+snippets_search_get_word_relevance (const gchar *search_word,
+                                    const gchar *key_word)
+{
+	SnippetsCountOccurrencesFunc count_occurrences = NULL;
+	gsize search_word_len = 0, key_word_len = 0;
+	guint count = 0;
+	gdouble relevance = 0.0;
+
+	search_word_len = strlen (search_word);
+	key_word_len    = strlen (key_word);
+	if (search_word_len == 0 || search_word_len > key_word_len)
+		return 0.0;
+
+	count_occurrences = snippets_search_get_count_occurrences ();
+	count = count_occurrences (key_word, key_word_len, search_word, search_word_len);
+	if (count == 0)
+		return 0.0;
+
+	relevance = count * RELEVANCE (search_word_len, key_word_len);
+	if (!memcmp (key_word, search_word, search_word_len))
+		relevance += (START_MATCH_BONUS - 1.0) * RELEVANCE (search_word_len, key_word_len);
+
+	return relevance;
+}
+
+/**
+ * snippets_search_get_fuzzy_word_relevance:
+ * @search_word: A lower-cased word typed by the user.
+ * @key_word: A lower-cased word of the snippet.
+ *
+ * An fzf-like score for @search_word as a subsequence of @key_word. The shortest
+ * window ending where the first match ends is scored: each matched character
+ * counts, with bonuses for matches at word boundaries and for consecutive matches,
+ * and penalties for the gaps between them.
+ *
+ * Returns: The relevance, 0 if @search_word isn't a subsequence of @key_word.
+ **/
+gdouble
+snippets_search_get_fuzzy_word_relevance (const gchar *search_word,
+                                          const gchar *key_word)
+{
+	gsize search_word_len = 0, key_word_len = 0, i = 0, j = 0, start = 0, end = 0;
+	gint score = 0, bonus = 0;
+	gboolean prev_matched = FALSE;
+
+	search_word_len = strlen (search_word);
+	key_word_len    = strlen (key_word);
+	if (search_word_len == 0 || search_word_len > key_word_len)
+		return 0.0;
+
+	/* Find where the first occurrence of the subsequence ends */
+	for (i = 0; i < key_word_len && j < search_word_len; i ++)
+	{
+		if (key_word[i] == search_word[j])
+			j ++;
+	}
+	if (j < search_word_len)
+		return 0.0;
+	end = i;
+
+	/* Go backwards to the latest start of an occurrence ending there */
+	start = end;
+	while (j > 0)
+	{
+		start --;
+		if (key_word[start] == search_word[j - 1])
+			j --;
+	}
+
+	/* Score the window */
+	for (i = start; i < end; i ++)
+	{
+		if (j < search_word_len && key_word[i] == search_word[j])
+		{
+			bonus = (i == 0 || IS_WORD_BOUNDARY (key_word[i - 1])) ? FUZZY_BONUS_BOUNDARY : 0;
+			if (j == 0)
+				bonus *= FUZZY_BONUS_FIRST_CHAR_FACTOR;
+			else
+			if (prev_matched)
+				bonus = MAX (bonus, FUZZY_BONUS_CONSECUTIVE);
+
+			score += FUZZY_SCORE_MATCH + bonus;
+			prev_matched = TRUE;
+			j ++;
+		}
+		else
+		{
+			score -= prev_matched ? FUZZY_PENALTY_GAP_START : FUZZY_PENALTY_GAP_EXTENSION;
+			prev_matched = FALSE;
+		}
+	}
+
+	/* Like RELEVANCE, the longer the key word the less relevant the match */
+	return (gdouble)MAX (score, 1) / (key_word_len - search_word_len + 1);
+}
+
+/**
+ * snippets_search_get_relevance:
+ * @trigger: The lower-cased trigger-key of the snippet.
+ * @name: The lower-cased name of the snippet.
+ * @keywords: A NULL-terminated array with the lower-cased keywords of the snippet.
+ * @words_list: The lower-cased words typed by the user.
+ * @get_word_relevance: Scores each of @words_list in a field of the snippet.
+ *
+ * Weighs the relevance of each typed word in the trigger-key, the name and the
+ * keywords of the snippet, the first keywords weighing more.
+ *
+ * Returns: The relevance of the snippet, 0 if any of the words doesn't match it.
+ **/
+gdouble
+snippets_search_get_relevance (const gchar *trigger,
+                               const gchar *name,
+                               gchar **keywords,
+                               GList *words_list,
+                               SnippetsWordRelevanceFunc get_word_relevance)
+{
+	const gchar *cur_word = NULL;
+	gdouble relevance = 0.0, word_relevance = 0.0, cur_relevance = 0.0,
+	        cur_keyword_relevance = 0.0;
+	GList *iter = NULL;
+	gint i = 0;
+
+	/* Assertions */
+	g_return_val_if_fail (trigger != NULL, 0.0);
+	g_return_val_if_fail (name != NULL, 0.0);
+	g_return_val_if_fail (keywords != NULL, 0.0);
+
+	/* If the user hasn't typed anything we just consider all snippets relevant */
+	if (words_list == NULL)
+		return 1.0;
+
+	/* We iterate over all the words. The snippet is relevant only if each of them
+	   matches it somewhere. */
+	for (iter = g_list_first (words_list); iter != NULL; iter = g_list_next (iter))
+	{
+		cur_word = (gchar *)iter->data;
+
+		/* Check the trigger-key */
+		cur_relevance = get_word_relevance (cur_word, trigger);
+		word_relevance = cur_relevance * TRIGGER_RELEVANCE;
+
+		/* Check the name */
+		cur_relevance = get_word_relevance (cur_word, name);
+		word_relevance += cur_relevance * NAME_RELEVANCE;
+
+		/* Check each keyword */
+		cur_keyword_relevance = FIRST_KEYWORD_RELEVANCE;
+		for (i = 0; keywords[i] != NULL; i ++)
+		{
+			/* If we have too many keywords */
+			if (cur_keyword_relevance < 0.0)
+				break;
+
+			cur_relevance = get_word_relevance (cur_word, keywords[i]);
+			word_relevance += cur_relevance * cur_keyword_relevance;
+
+			cur_keyword_relevance -= KEYWORD_RELEVANCE_DEC; 
+		}
+
+		if (word_relevance == 0.0)
+			return 0.0;
+		relevance += word_relevance;
+	}
+
+	return relevance;
+}
@@ -0,0 +1,77 @@
+/* -*- Mode: C; indent-tabs-mode: t; c-basic-offset: 4; tab-width: 4 -*- */
+/*
+    snippets-search.h
+    Copyright (C) Dragos Dena 2010
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, 
+	Boston, MA  02110-1301  USA
+*/
+
+#ifndef __SNIPPETS_SEARCH_H__
+#define __SNIPPETS_SEARCH_H__
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+#define TRIGGER_RELEVANCE        1000
+#define NAME_RELEVANCE           1000
+#define FIRST_KEYWORD_RELEVANCE  100
+#define KEYWORD_RELEVANCE_DEC    5
+#define START_MATCH_BONUS        1.7
+
+#define RELEVANCE(search_str_len, key_len)  ((gdouble)(search_str_len)/(key_len - search_str_len + 1))
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SNIPPETS_SEARCH_HAVE_X86_SIMD 1
+#endif
+
+/* Counts the occurrences of needle in haystack, overlapping ones included. The
+   needle must be non-empty and not longer than the haystack. */
+typedef guint (*SnippetsCountOccurrencesFunc) (const gchar *haystack,
+                                               gsize haystack_len,
+                                               const gchar *needle,
+                                               gsize needle_len);
+
+/* Scores how well a lower-cased search word matches a lower-cased key word, 0 meaning
+   it doesn't match at all. */
+typedef gdouble (*SnippetsWordRelevanceFunc) (const gchar *search_word,
+                                              const gchar *key_word);
+
+guint                         snippets_search_count_occurrences_scalar (const gchar *haystack,
+                                                                        gsize haystack_len,
+                                                                        const gchar *needle,
+                                                                        gsize needle_len);
+#ifdef SNIPPETS_SEARCH_HAVE_X86_SIMD
+guint                         snippets_search_count_occurrences_sse2   (const gchar *haystack,
+                                                                        gsize haystack_len,
+                                                                        const gchar *needle,
+                                                                        gsize needle_len);
+#endif
+SnippetsCountOccurrencesFunc  snippets_search_get_count_occurrences    (void);
+
+gdouble                       snippets_search_get_word_relevance       (const gchar *search_word,
+                                                                        const gchar *key_word);
+gdouble                       snippets_search_get_fuzzy_word_relevance (const gchar *search_word,
+                                                                        const gchar *key_word);
+gdouble                       snippets_search_get_relevance            (const gchar *trigger,
+                                                                        const gchar *name,
+                                                                        gchar **keywords,
+                                                                        GList *words_list,
+                                                                        SnippetsWordRelevanceFunc get_word_relevance);
+
+G_END_DECLS
+
+#endif /* __SNIPPETS_SEARCH_H__ */
@@ -257,7 +257,8 @@ static gboolean
 write_snippets_group (GOutputStream *os,
                       AnjutaSnippetsGroup *snippets_group)
 {
-	GList *iter = NULL, *snippets = NULL;
+	AnjutaSnippet *cur_snippet = NULL;
+	guint i = 0;
 
 	/* Assertions */
 	g_return_val_if_fail (G_IS_OUTPUT_STREAM (os), FALSE);
@@ -273,13 +274,13 @@ write_snippets_group (GOutputStream *os,
 	write_simple_start_tag (os, NATIVE_XML_SNIPPETS_TAG);
 
 	/* Write the snippets */
-	snippets = snippets_group_get_snippets_list (snippets_group);
-	for (iter = g_list_first (snippets); iter != NULL; iter = g_list_next (iter))
+	for (i = 0; i < snippets_group_get_n_snippets (snippets_group); i ++)
 	{
-		if (!ANJUTA_IS_SNIPPET (iter->data))
+		cur_snippet = snippets_group_get_nth_snippet (snippets_group, i);
+		if (!ANJUTA_IS_SNIPPET (cur_snippet))
 			continue;
 
-		write_snippet (os, ANJUTA_SNIPPET (iter->data));
+		write_snippet (os, cur_snippet);
 	}
 	write_simple_end_tag (os, NATIVE_XML_SNIPPETS_TAG);
 
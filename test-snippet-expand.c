@@ -0,0 +1,200 @@
+/* -*- Mode: C; indent-tabs-mode: t; c-basic-offset: 4; tab-width: 4 -*- */
+/*
+    test-snippet-expand.c
+    Copyright (C) Dragos Dena 2010
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, 
+	Boston, MA  02110-1301  USA
+*/
+
+#include <string.h>
+#include "snippet.h"
+#include "snippets-db.h"
+
+/* The expansion fills a buffer sized up front, and warns if it wasn't filled
+   exactly. The warnings are fatal in the tests. */
+
+static AnjutaSnippet *
+new_snippet (const gchar *content)
+{
+	GList *languages = g_list_append (NULL, "C");
+	AnjutaSnippet *snippet = NULL;
+
+	snippet = snippet_new ("trigger", languages, "Name", content, NULL, NULL, NULL, NULL);
+	g_list_free (languages);
+
+	return snippet;
+}
+
+static void
+assert_expansion_text (const AnjutaSnippetExpansion *expansion,
+                       const gchar *expected)
+{
+	g_assert_cmpstr (expansion->text, ==, expected);
+	g_assert_cmpuint (strlen (expansion->text), ==, strlen (expected));
+}
+
+static void
+assert_variable_positions (const AnjutaSnippetExpansion *expansion,
+                           guint variable_index,
+                           const gchar *value,
+                           guint n_positions)
+{
+	const AnjutaSnippetExpandedVariable *variable = &expansion->variables[variable_index];
+	const gchar *cur_text = expansion->text;
+	gint position = 0;
+	guint i = 0;
+
+	g_assert_cmpint (variable->value_len, ==, strlen (value));
+	g_assert_cmpuint (variable->positions->len, ==, n_positions);
+	for (i = 0; i < n_positions; i ++)
+	{
+		position = g_array_index (variable->positions, gint, i);
+		g_assert (strncmp (expansion->text + position, value, variable->value_len) == 0);
+
+		/* The positions are in order */
+		g_assert (expansion->text + position >= cur_text);
+		cur_text = expansion->text + position + variable->value_len;
+	}
+}
+
+static void
+test_expand_indentation (void)
+{
+	SnippetsDB *snippets_db = snippets_db_new ();
+	AnjutaSnippet *snippet = NULL;
+	AnjutaSnippetExpansion *expansion = NULL;
+
+	/* Every new line is indented, the one at the end too */
+	snippet = new_snippet ("{\n\tfoo ();\n}\n");
+
+	expansion = snippet_expand (snippet, G_OBJECT (snippets_db), "    ");
+	assert_expansion_text (expansion, "{\n    \tfoo ();\n    }\n    ");
+	g_assert_cmpint (expansion->end_position, ==, -1);
+	snippet_expansion_free (expansion);
+
+	expansion = snippet_expand (snippet, G_OBJECT (snippets_db), "");
+	assert_expansion_text (expansion, "{\n\tfoo ();\n}\n");
+	snippet_expansion_free (expansion);
+
+	/* Without a database, the content is only indented */
+	expansion = snippet_expand (snippet, NULL, "\t");
+	assert_expansion_text (expansion, "{\n\t\tfoo ();\n\t}\n\t");
+	snippet_expansion_free (expansion);
+
+	g_object_unref (snippet);
+	g_object_unref (snippets_db);
+}
+
+static void
+test_expand_variables (void)
+{
+	SnippetsDB *snippets_db = snippets_db_new ();
+	AnjutaSnippet *snippet = NULL;
+	AnjutaSnippetExpansion *expansion = NULL;
+	const gchar *expected = NULL;
+
+	snippet = new_snippet ("for (${i} = 0; ${i} < ${n}; ${i} ++)\n{\n\t${END_CURSOR_POSITION}\n}\n${unknown}");
+	snippet_add_variable (snippet, "i", "index", FALSE);
+	snippet_add_variable (snippet, "n", "", FALSE);
+
+	expected  = "for (index = 0; index < ; index ++)\n  {\n  \t\n  }\n  ${unknown}";
+	expansion = snippet_expand (snippet, G_OBJECT (snippets_db), "  ");
+	assert_expansion_text (expansion, expected);
+	assert_variable_positions (expansion, 0, "index", 3);
+	assert_variable_positions (expansion, 1, "", 1);
+	g_assert_cmpint (g_array_index (expansion->variables[1].positions, gint, 0), ==,
+	                 strlen ("for (index = 0; index < "));
+	g_assert_cmpint (expansion->end_position, ==,
+	                 strlen ("for (index = 0; index < ; index ++)\n  {\n  \t"));
+	snippet_expansion_free (expansion);
+
+	/* The second expansion comes from the cache and must be the same */
+	expansion = snippet_expand (snippet, G_OBJECT (snippets_db), "  ");
+	assert_expansion_text (expansion, expected);
+	assert_variable_positions (expansion, 0, "index", 3);
+	snippet_expansion_free (expansion);
+
+	g_object_unref (snippet);
+	g_object_unref (snippets_db);
+}
+
+static void
+test_expand_global_variables (void)
+{
+	SnippetsDB *snippets_db = snippets_db_new ();
+	AnjutaSnippet *snippet = NULL;
+	AnjutaSnippetExpansion *expansion = NULL;
+	gchar *default_content = NULL;
+
+	snippets_db_add_global_variable (snippets_db, "user", "Dragos Dena", FALSE, TRUE);
+
+	snippet = new_snippet ("/*\n * ${user}\n * ${missing}\n */\n");
+	snippet_add_variable (snippet, "user", "nobody", TRUE);
+	snippet_add_variable (snippet, "missing", "default", TRUE);
+
+	expansion = snippet_expand (snippet, G_OBJECT (snippets_db), "\t");
+	assert_expansion_text (expansion, "/*\n\t * Dragos Dena\n\t * default\n\t */\n\t");
+	assert_variable_positions (expansion, 0, "Dragos Dena", 1);
+	assert_variable_positions (expansion, 1, "default", 1);
+	snippet_expansion_free (expansion);
+
+	/* The default content is the expanded text */
+	default_content = snippet_get_default_content (snippet, G_OBJECT (snippets_db), "\t");
+	g_assert_cmpstr (default_content, ==, "/*\n\t * Dragos Dena\n\t * default\n\t */\n\t");
+	g_free (default_content);
+
+	g_object_unref (snippet);
+	g_object_unref (snippets_db);
+}
+
+static void
+test_preview (void)
+{
+	AnjutaSnippet *snippet = NULL;
+
+	snippet = new_snippet ("/* ${user} */\nfor (${i} = 0; ${i} < ${n}; ${i} ++)\n\t${END_CURSOR_POSITION}${unknown}\n");
+	snippet_add_variable (snippet, "user", "nobody", TRUE);
+	snippet_add_variable (snippet, "i", "index", FALSE);
+	snippet_add_variable (snippet, "n", "", FALSE);
+
+	/* The global variables aren't resolved and there is no indentation */
+	g_assert_cmpstr (snippet_get_preview (snippet), ==,
+	                 "/* ${user} */\nfor (index = 0; index < ; index ++)\n\t${unknown}\n");
+
+	/* It's computed again when the variables change */
+	snippet_set_variable_default_value (snippet, "n", "count");
+	g_assert_cmpstr (snippet_get_preview (snippet), ==,
+	                 "/* ${user} */\nfor (index = 0; index < count; index ++)\n\t${unknown}\n");
+
+	g_object_unref (snippet);
+}
+
+int
+main (int argc,
+      char *argv[])
+{
+#if !GLIB_CHECK_VERSION (2, 35, 0)
+	g_type_init ();
+#endif
+	g_test_init (&argc, &argv, NULL);
+
+	g_test_add_func ("/snippet/expand/indentation", test_expand_indentation);
+	g_test_add_func ("/snippet/expand/variables", test_expand_variables);
+	g_test_add_func ("/snippet/expand/global-variables", test_expand_global_variables);
+	g_test_add_func ("/snippet/preview", test_preview);
+
+	return g_test_run ();
+}
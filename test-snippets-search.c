@@ -0,0 +1,206 @@
+/* -*- Mode: C; indent-tabs-mode: t; c-basic-offset: 4; tab-width: 4 -*- */
+/*
+    test-snippets-search.c
+    Copyright (C) Dragos Dena 2010
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, 
+	Boston, MA  02110-1301  USA
+*/
+
+#include <string.h>
+#include "snippets-search.h"
+
+/* The kernels read whole blocks, so the haystacks are copied at every offset
+   up to MAX_START_OFFSET of a buffer to test unaligned loads. The lengths go
+   past several SSE2 blocks, to cover every remainder of 16. */
+#define MAX_START_OFFSET   8
+#define MAX_HAYSTACK_LEN   80
+#define MAX_NEEDLE_LEN     40
+#define RANDOM_CASES       20000
+
+static void
+check_kernels (const gchar *haystack,
+               gsize haystack_len,
+               const gchar *needle,
+               gsize needle_len)
+{
+	gchar *buffer = NULL;
+	const gchar *cur_haystack = NULL;
+	guint expected = 0, offset = 0;
+
+	if (needle_len == 0 || needle_len > haystack_len)
+		return;
+
+	buffer = g_malloc (haystack_len + MAX_START_OFFSET);
+	for (offset = 0; offset < MAX_START_OFFSET; offset ++)
+	{
+		memcpy (buffer + offset, haystack, haystack_len);
+		cur_haystack = buffer + offset;
+
+		expected = snippets_search_count_occurrences_scalar (cur_haystack, haystack_len,
+		                                                     needle, needle_len);
+#ifdef SNIPPETS_SEARCH_HAVE_X86_SIMD
+		g_assert_cmpuint (snippets_search_count_occurrences_sse2 (cur_haystack, haystack_len,
+		                                                          needle, needle_len),
+		                  ==, expected);
+#endif
+		g_assert_cmpuint (snippets_search_get_count_occurrences () (cur_haystack, haystack_len,
+		                                                            needle, needle_len),
+		                  ==, expected);
+	}
+
+	g_free (buffer);
+}
+
+static void
+test_scalar_counts (void)
+{
+	g_assert_cmpuint (snippets_search_count_occurrences_scalar ("aaaa", 4, "aa", 2), ==, 3);
+	g_assert_cmpuint (snippets_search_count_occurrences_scalar ("abcabc", 6, "abc", 3), ==, 2);
+	g_assert_cmpuint (snippets_search_count_occurrences_scalar ("abcabc", 6, "abd", 3), ==, 0);
+	g_assert_cmpuint (snippets_search_count_occurrences_scalar ("abc", 3, "abc", 3), ==, 1);
+}
+
+/* Periodic haystacks give overlapping matches at every offset of a block */
+static void
+test_kernels_periodic (void)
+{
+	gchar haystack[MAX_HAYSTACK_LEN], needle[MAX_NEEDLE_LEN];
+	gsize haystack_len = 0, needle_len = 0;
+
+	memset (haystack, 'a', MAX_HAYSTACK_LEN);
+	memset (needle, 'a', MAX_NEEDLE_LEN);
+	for (haystack_len = 1; haystack_len <= MAX_HAYSTACK_LEN; haystack_len ++)
+		for (needle_len = 1; needle_len <= MAX_NEEDLE_LEN; needle_len ++)
+			check_kernels (haystack, haystack_len, needle, needle_len);
+}
+
+/* A single match at each position, so it starts in one block and ends in the
+   next one for the long needles, and the first and last bytes differ from the
+   rest of the haystack */
+static void
+test_kernels_block_boundaries (void)
+{
+	gchar haystack[MAX_HAYSTACK_LEN], needle[MAX_NEEDLE_LEN];
+	gsize haystack_len = 0, needle_len = 0, pos = 0, i = 0;
+
+	for (needle_len = 1; needle_len <= MAX_NEEDLE_LEN; needle_len ++)
+	{
+		for (i = 0; i < needle_len; i ++)
+			needle[i] = 'b' + i % 20;
+
+		for (haystack_len = needle_len; haystack_len <= MAX_HAYSTACK_LEN; haystack_len ++)
+		{
+			for (pos = 0; pos + needle_len <= haystack_len; pos ++)
+			{
+				memset (haystack, 'a', haystack_len);
+				memcpy (haystack + pos, needle, needle_len);
+				check_kernels (haystack, haystack_len, needle, needle_len);
+
+				/* Only the middle of the needle differs */
+				if (needle_len > 2)
+				{
+					haystack[pos + needle_len / 2] = 'a';
+					check_kernels (haystack, haystack_len, needle, needle_len);
+				}
+			}
+		}
+	}
+}
+
+/* Small alphabets give many partial matches, where only the first and last
+   bytes of the needle match */
+static void
+test_kernels_random (void)
+{
+	gchar haystack[MAX_HAYSTACK_LEN], needle[MAX_NEEDLE_LEN];
+	gsize haystack_len = 0, needle_len = 0, i = 0;
+	gint n_case = 0, alphabet = 0;
+
+	for (n_case = 0; n_case < RANDOM_CASES; n_case ++)
+	{
+		alphabet     = g_test_rand_int_range (2, 5);
+		haystack_len = g_test_rand_int_range (1, MAX_HAYSTACK_LEN + 1);
+		needle_len   = g_test_rand_int_range (1, MIN (haystack_len, MAX_NEEDLE_LEN) + 1);
+
+		for (i = 0; i < haystack_len; i ++)
+			haystack[i] = 'a' + g_test_rand_int_range (0, alphabet);
+		for (i = 0; i < needle_len; i ++)
+			needle[i] = 'a' + g_test_rand_int_range (0, alphabet);
+
+		check_kernels (haystack, haystack_len, needle, needle_len);
+	}
+}
+
+static void
+test_word_relevance (void)
+{
+	/* A substring scores more at the start of the key word */
+	g_assert (snippets_search_get_word_relevance ("for", "for_loop") >
+	          snippets_search_get_word_relevance ("for", "loop_for"));
+	g_assert (snippets_search_get_word_relevance ("fori", "for_index") == 0.0);
+	g_assert (snippets_search_get_word_relevance ("for_index", "for") == 0.0);
+
+	/* A subsequence scores more at word boundaries */
+	g_assert (snippets_search_get_fuzzy_word_relevance ("fori", "for_index") > 0.0);
+	g_assert (snippets_search_get_fuzzy_word_relevance ("fi", "for_index") >
+	          snippets_search_get_fuzzy_word_relevance ("fi", "forxindex"));
+	g_assert (snippets_search_get_fuzzy_word_relevance ("ixf", "for_index") == 0.0);
+}
+
+static void
+test_relevance (void)
+{
+	gchar *keywords[] = {"loop", "index", NULL};
+	GList *words_list = NULL;
+
+	g_assert (snippets_search_get_relevance ("fori", "for loop", keywords, NULL,
+	                                         snippets_search_get_word_relevance) == 1.0);
+
+	/* Every word must match somewhere */
+	words_list = g_list_append (NULL, "for");
+	words_list = g_list_append (words_list, "index");
+	g_assert (snippets_search_get_relevance ("fori", "for loop", keywords, words_list,
+	                                         snippets_search_get_word_relevance) > 0.0);
+	words_list = g_list_append (words_list, "while");
+	g_assert (snippets_search_get_relevance ("fori", "for loop", keywords, words_list,
+	                                         snippets_search_get_word_relevance) == 0.0);
+	g_list_free (words_list);
+
+	/* The trigger-key weighs more than the keywords */
+	words_list = g_list_append (NULL, "loop");
+	g_assert (snippets_search_get_relevance ("loop", "", keywords, words_list,
+	                                         snippets_search_get_word_relevance) >
+	          snippets_search_get_relevance ("fori", "", keywords, words_list,
+	                                         snippets_search_get_word_relevance));
+	g_list_free (words_list);
+}
+
+int
+main (int argc,
+      char *argv[])
+{
+	g_test_init (&argc, &argv, NULL);
+
+	g_test_add_func ("/snippets-search/count-occurrences/scalar", test_scalar_counts);
+	g_test_add_func ("/snippets-search/count-occurrences/periodic", test_kernels_periodic);
+	g_test_add_func ("/snippets-search/count-occurrences/block-boundaries",
+	                 test_kernels_block_boundaries);
+	g_test_add_func ("/snippets-search/count-occurrences/random", test_kernels_random);
+	g_test_add_func ("/snippets-search/word-relevance", test_word_relevance);
+	g_test_add_func ("/snippets-search/relevance", test_relevance);
+
+	return g_test_run ();
+}